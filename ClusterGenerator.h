@@ -0,0 +1,43 @@
+#ifndef CLUSTER_GENERATOR_H
+#define CLUSTER_GENERATOR_H
+
+#include <random>
+#include <string>
+#include <vector>
+
+#include "Point.h"
+
+// Datos sintéticos de los benchmarks: una mezcla de NUM_CLUSTERS gaussianas con centros uniformes en
+// [-10, 10] y desviación 1. Los centros se sortean aparte de las muestras para que las consultas salgan
+// de la misma distribución que los datos (mismos centros, ruido nuevo) y no caigan entre los clusters.
+
+const size_t NUM_CLUSTERS = 20;
+
+inline std::vector<Point> clusterCenters(size_t dim, std::mt19937& gen) {
+    std::uniform_real_distribution<> centerDis(-10.0, 10.0);
+    std::vector<Point> centers(NUM_CLUSTERS, Point(dim));
+    for (Point& center : centers) {
+        for (size_t j = 0; j < dim; ++j) {
+            center[j] = centerDis(gen);
+        }
+    }
+    return centers;
+}
+
+// n puntos alrededor de centros elegidos al azar; la ruta de cada punto es su número de fila
+inline std::vector<Point> sampleClusters(const std::vector<Point>& centers, size_t n, std::mt19937& gen) {
+    std::normal_distribution<> noise(0.0, 1.0);
+    std::uniform_int_distribution<size_t> pick(0, centers.size() - 1);
+    size_t dim = centers.empty() ? 0 : centers[0].dim();
+    std::vector<Point> points(n, Point(dim));
+    for (size_t i = 0; i < n; ++i) {
+        const Point& center = centers[pick(gen)];
+        for (size_t j = 0; j < dim; ++j) {
+            points[i][j] = center[j].getValue() + noise(gen);
+        }
+        points[i].path = std::to_string(i);
+    }
+    return points;
+}
+
+#endif // CLUSTER_GENERATOR_H
@@ -1,62 +1,343 @@
 #include "CortexAPI.h"
 
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+
+CortexConfig CortexConfig::fromEnvironment() {
+    CortexConfig config;
+    if (const char* endpoint = std::getenv("CORTEX_ENDPOINT")) {
+        config.endpoint = endpoint;
+    }
+    if (const char* apiKey = std::getenv("CORTEX_API_KEY")) {
+        config.apiKey = apiKey;
+    }
+    if (const char* batchSize = std::getenv("CORTEX_BATCH_SIZE")) {
+        config.batchSize = std::max<size_t>(std::strtoul(batchSize, nullptr, 10), 1);
+    }
+    if (const char* maxConnections = std::getenv("CORTEX_MAX_CONNECTIONS")) {
+        config.maxConnections = std::max<size_t>(std::strtoul(maxConnections, nullptr, 10), 1);
+    }
+    if (const char* timeoutMs = std::getenv("CORTEX_TIMEOUT_MS")) {
+        config.timeoutMs = std::strtol(timeoutMs, nullptr, 10);
+    }
+    if (const char* cachePath = std::getenv("CORTEX_CACHE")) {
+        config.cachePath = cachePath;
+    }
+    return config;
+}
+
 size_t CortexAPI::WriteCallback(void* contents, size_t size, size_t nmemb, void* userp) {
-    ((std::string*)userp)->append((char*)contents, size * nmemb);
+    Request* request = static_cast<Request*>(userp);
+    // Con Content-Length conocido la respuesta se recibe en un solo bloque, sin realocaciones
+    if (request->response.empty()) {
+        curl_off_t length = -1;
+        curl_easy_getinfo(request->handle, CURLINFO_CONTENT_LENGTH_DOWNLOAD_T, &length);
+        if (length > 0) {
+            request->response.reserve(static_cast<size_t>(length));
+        }
+    }
+    request->response.append(static_cast<char*>(contents), size * nmemb);
     return size * nmemb;
 }
 
-CortexAPI::CortexAPI() {
+CortexAPI::CortexAPI(const CortexConfig& config) : config(config) {
     curl_global_init(CURL_GLOBAL_DEFAULT);
+    multi = curl_multi_init();
+    curl_multi_setopt(multi, CURLMOPT_MAX_HOST_CONNECTIONS, static_cast<long>(this->config.maxConnections));
+    curl_multi_setopt(multi, CURLMOPT_MAXCONNECTS, static_cast<long>(this->config.maxConnections));
+
+    // Sin "Expect: 100-continue" el cuerpo sale junto con la cabecera: un viaje de ida y vuelta menos
+    headers = curl_slist_append(headers, "Expect:");
+    // Se prefiere la respuesta binaria (float32 little-endian), que no hay que convertir desde texto
+    headers = curl_slist_append(headers, "Accept: application/octet-stream, text/csv;q=0.9, application/json;q=0.8");
+    if (!this->config.apiKey.empty()) {
+        headers = curl_slist_append(headers, ("x-api-key: " + this->config.apiKey).c_str());
+    }
+    if (!this->config.cachePath.empty()) {
+        cache = std::make_unique<EmbeddingCache>(this->config.cachePath);
+    }
+    worker = std::thread(&CortexAPI::run, this);
 }
 
 CortexAPI::~CortexAPI() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    curl_multi_wakeup(multi);
+    worker.join();
+
+    for (CURL* handle : idleHandles) {
+        curl_easy_cleanup(handle);
+    }
+    curl_multi_cleanup(multi);
+    curl_slist_free_all(headers);
     curl_global_cleanup();
 }
 
-std::vector<NType> CortexAPI::postImage(const std::string& imagePath) {
-    CURL* curl;
-    CURLcode res;
-    std::string readBuffer;
+std::future<CortexAPI::Embeddings> CortexAPI::submit(std::vector<std::string> imagePaths) {
+    Request* request = new Request();
+    request->imagePaths = std::move(imagePaths);
+    std::future<Embeddings> result = request->result.get_future();
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (stopping) {
+            delete request;
+            throw std::runtime_error("CortexAPI is shutting down");
+        }
+        pending.push_back(request);
+    }
+    curl_multi_wakeup(multi);
+    return result;
+}
 
-    struct curl_httppost* post = NULL;
-    struct curl_httppost* last = NULL;
+// Solo lo llama el hilo del multi
+void CortexAPI::start(Request* request) {
+    CURL* handle;
+    if (!idleHandles.empty()) {
+        handle = idleHandles.back();
+        idleHandles.pop_back();
+    } else {
+        handle = curl_easy_init();
+        curl_easy_setopt(handle, CURLOPT_URL, config.endpoint.c_str());
+        curl_easy_setopt(handle, CURLOPT_HTTPHEADER, headers);
+        curl_easy_setopt(handle, CURLOPT_WRITEFUNCTION, WriteCallback);
+        curl_easy_setopt(handle, CURLOPT_TIMEOUT_MS, config.timeoutMs);
+        curl_easy_setopt(handle, CURLOPT_TCP_KEEPALIVE, 1L);
+        curl_easy_setopt(handle, CURLOPT_NOSIGNAL, 1L);
+    }
+    request->handle = handle;
 
-    curl = curl_easy_init();
+    request->form = curl_mime_init(handle);
+    for (const std::string& imagePath : request->imagePaths) {
+        curl_mimepart* part = curl_mime_addpart(request->form);
+        curl_mime_name(part, "image");
+        curl_mime_filedata(part, imagePath.c_str());
+        curl_mime_type(part, "image/jpeg");
+    }
+    curl_easy_setopt(handle, CURLOPT_MIMEPOST, request->form);
+    curl_easy_setopt(handle, CURLOPT_WRITEDATA, request);
+    curl_easy_setopt(handle, CURLOPT_PRIVATE, request);
+    curl_multi_add_handle(multi, handle);
+    inFlight.push_back(request);
+}
 
-    if(curl) {
-        curl_formadd(&post, &last,
-                     CURLFORM_COPYNAME, "image",
-                     CURLFORM_FILE, imagePath.c_str(),
-                     CURLFORM_CONTENTTYPE, "image/jpeg",
-                     CURLFORM_END);
+void CortexAPI::finish(Request* request, CURLcode code) {
+    long status = 0;
+    curl_easy_getinfo(request->handle, CURLINFO_RESPONSE_CODE, &status);
+    char* contentType = nullptr;
+    curl_easy_getinfo(request->handle, CURLINFO_CONTENT_TYPE, &contentType);
+    if (contentType) {
+        request->contentType = contentType;
+    }
+    curl_multi_remove_handle(multi, request->handle);
+    curl_easy_setopt(request->handle, CURLOPT_MIMEPOST, nullptr);
+    curl_mime_free(request->form);
+    idleHandles.push_back(request->handle);
+    inFlight.erase(std::find(inFlight.begin(), inFlight.end(), request));
 
-        curl_easy_setopt(curl, CURLOPT_URL, "https://7m15gatms9.execute-api.us-east-1.amazonaws.com/v1/embeddings");
-        curl_easy_setopt(curl, CURLOPT_HTTPPOST, post);
-        curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, WriteCallback);
-        curl_easy_setopt(curl, CURLOPT_WRITEDATA, &readBuffer);
-        struct curl_slist* list = NULL;
-        list = curl_slist_append(list, "x-api-key: <KEY>");
-        curl_easy_setopt(curl, CURLOPT_HTTPHEADER, list);
+    try {
+        if (code != CURLE_OK) {
+            throw std::runtime_error(std::string("curl_easy_perform() failed: ") + curl_easy_strerror(code));
+        }
+        if (status >= 400) {
+            throw std::runtime_error("Embedding service answered HTTP " + std::to_string(status));
+        }
+        request->result.set_value(parseEmbeddings(request->response, request->contentType, request->imagePaths.size()));
+    } catch (...) {
+        request->result.set_exception(std::current_exception());
+    }
+    delete request;
+}
 
-        res = curl_easy_perform(curl);
-        if(res != CURLE_OK) {
-            std::cerr << "curl_easy_perform() failed: " << curl_easy_strerror(res) << std::endl;
+void CortexAPI::run() {
+    while (true) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (stopping) {
+                break;
+            }
+            while (!pending.empty()) {
+                start(pending.front());
+                pending.pop_front();
+            }
         }
 
-        curl_easy_cleanup(curl);
-        curl_formfree(post);
-        curl_slist_free_all(list);
+        int running = 0;
+        curl_multi_perform(multi, &running);
+        int left = 0;
+        while (CURLMsg* message = curl_multi_info_read(multi, &left)) {
+            if (message->msg == CURLMSG_DONE) {
+                Request* request = nullptr;
+                curl_easy_getinfo(message->easy_handle, CURLINFO_PRIVATE, &request);
+                finish(request, message->data.result);
+            }
+        }
+        // Duerme hasta que haya actividad en los sockets o submit() lo despierte
+        curl_multi_poll(multi, nullptr, 0, 1000, nullptr);
     }
 
-    std::stringstream ss(readBuffer);
-    NType value;
-    std::vector<NType> resultVector;
-    while (ss >> value) {
-        resultVector.push_back(value);
-        if (ss.peek() == ',') {
-            ss.ignore();
+    // Al cerrar, las peticiones sin terminar fallan en lugar de quedar colgadas
+    std::lock_guard<std::mutex> lock(mutex);
+    for (Request* request : pending) {
+        request->result.set_exception(std::make_exception_ptr(std::runtime_error("CortexAPI is shutting down")));
+        delete request;
+    }
+    pending.clear();
+    while (!inFlight.empty()) {
+        finish(inFlight.back(), CURLE_ABORTED_BY_CALLBACK);
+    }
+}
+
+// Números de un embedding en texto: CSV (una línea por imagen) o JSON ([...] o [[...], [...]], también
+// dentro de un objeto). En JSON solo cuentan los números dentro de corchetes, así que campos como
+// "dim": 2048 no se confunden con coordenadas.
+static std::vector<NType> parseText(const std::string& text) {
+    std::vector<NType> values;
+    values.reserve(text.size() / 8);    // cota inferior típica: "-0.0123," ocupa 8 caracteres
+    const char* p = text.data();
+    const char* end = p + text.size();
+    const char* first = std::find_if(p, end, [](char c) { return !std::isspace(static_cast<unsigned char>(c)); });
+    bool json = first != end && (*first == '[' || *first == '{');
+    int depth = 0;
+    while (p < end) {
+        char c = *p;
+        if (c == '[') {
+            ++depth;
+        } else if (c == ']') {
+            --depth;
+        } else if (c == '"') {
+            p = std::find(p + 1, end, '"');     // las claves de JSON no contienen números de interés
+        } else if ((c == '-' || c == '.' || (c >= '0' && c <= '9')) && (!json || depth > 0)) {
+            float value;
+            std::from_chars_result parsed = std::from_chars(p, end, value);
+            if (parsed.ec != std::errc()) {
+                throw std::runtime_error("Malformed number in embedding response");
+            }
+            values.push_back(value);
+            p = parsed.ptr;
+            continue;
+        }
+        ++p;
+    }
+    return values;
+}
+
+// float32 little-endian, uno tras otro
+static std::vector<NType> parseBinary(const std::string& payload) {
+    if (payload.size() % sizeof(float) != 0) {
+        throw std::runtime_error("Binary embedding response is not a whole number of float32 values");
+    }
+    std::vector<NType> values(payload.size() / sizeof(float));
+    for (size_t i = 0; i < values.size(); ++i) {
+        float value;
+        std::memcpy(&value, payload.data() + i * sizeof(float), sizeof(float));
+        values[i] = value;
+    }
+    return values;
+}
+
+// La respuesta trae los expected embeddings seguidos y todos de la misma dimensión. Con una sola imagen
+// el vector leído es directamente el embedding (y luego las coordenadas del Point de la consulta).
+CortexAPI::Embeddings CortexAPI::parseEmbeddings(const std::string& response, const std::string& contentType,
+                                                 size_t expected) {
+    std::vector<NType> values = contentType.compare(0, 24, "application/octet-stream") == 0 ? parseBinary(response)
+                                                                                            : parseText(response);
+    if (values.empty() || values.size() % expected != 0) {
+        throw std::runtime_error("Embedding service returned " + std::to_string(values.size()) + " values for " +
+                                 std::to_string(expected) + " images");
+    }
+    Embeddings embeddings;
+    if (expected == 1) {
+        embeddings.push_back(std::move(values));
+        return embeddings;
+    }
+    size_t dim = values.size() / expected;
+    embeddings.reserve(expected);
+    for (size_t i = 0; i < expected; ++i) {
+        embeddings.emplace_back(values.begin() + i * dim, values.begin() + (i + 1) * dim);
+    }
+    return embeddings;
+}
+
+// Falso si no hay caché o la imagen no se puede leer; en ese caso el servicio reportará el error
+bool CortexAPI::cacheKey(const std::string& imagePath, EmbeddingCache::Key& key) const {
+    if (!cache) {
+        return false;
+    }
+    try {
+        key = EmbeddingCache::keyOfFile(imagePath);
+        return true;
+    } catch (std::exception&) {
+        return false;
+    }
+}
+
+std::vector<NType> CortexAPI::postImage(const std::string& imagePath) {
+    try {
+        return postImageAsync(imagePath).get();
+    } catch (std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return {};
+    }
+}
+
+std::future<std::vector<NType>> CortexAPI::postImageAsync(const std::string& imagePath) {
+    EmbeddingCache::Key key;
+    bool cacheable = cacheKey(imagePath, key);
+    std::vector<NType> cached;
+    if (cacheable && cache->get(key, cached)) {
+        std::promise<std::vector<NType>> hit;
+        hit.set_value(std::move(cached));
+        return hit.get_future();
+    }
+
+    // std::async acepta tareas que solo se mueven: el future se mueve a la tarea y el embedding sale sin copiarse
+    std::future<Embeddings> result = submit({imagePath});
+    return std::async(std::launch::deferred, [this, result = std::move(result), cacheable, key]() mutable {
+        std::vector<NType> embedding = std::move(result.get()[0]);
+        if (cacheable) {
+            cache->put(key, embedding);
+        }
+        return embedding;
+    });
+}
+
+std::vector<std::vector<NType>> CortexAPI::postImages(const std::vector<std::string>& imagePaths) {
+    std::vector<std::vector<NType>> embeddings(imagePaths.size());
+    std::vector<EmbeddingCache::Key> keys(imagePaths.size());
+    std::vector<bool> cacheable(imagePaths.size());
+    std::vector<size_t> misses;
+    for (size_t i = 0; i < imagePaths.size(); ++i) {
+        cacheable[i] = cacheKey(imagePaths[i], keys[i]);
+        if (!cacheable[i] || !cache->get(keys[i], embeddings[i])) {
+            misses.push_back(i);
         }
     }
 
-    return resultVector;
-}
\ No newline at end of file
+    // Solo las imágenes que no están en la caché viajan al servicio, en lotes de config.batchSize
+    std::vector<std::future<Embeddings>> batches;
+    for (size_t start = 0; start < misses.size(); start += config.batchSize) {
+        size_t end = std::min(misses.size(), start + config.batchSize);
+        std::vector<std::string> batch;
+        for (size_t j = start; j < end; ++j) {
+            batch.push_back(imagePaths[misses[j]]);
+        }
+        batches.push_back(submit(std::move(batch)));
+    }
+    size_t next = 0;
+    for (std::future<Embeddings>& batch : batches) {
+        for (std::vector<NType>& embedding : batch.get()) {
+            size_t i = misses[next++];
+            embeddings[i] = std::move(embedding);
+            if (cacheable[i]) {
+                cache->put(keys[i], embeddings[i]);
+            }
+        }
+    }
+    return embeddings;
+}
@@ -4,22 +4,79 @@
 #include <iostream>
 #include <string>
 #include <vector>
-#include <sstream>
+#include <deque>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
 #include <curl/curl.h>
- 
+
 #include "params.h"
+#include "EmbeddingCache.h"
+
+// Configuración del servicio de embeddings. fromEnvironment lee CORTEX_ENDPOINT, CORTEX_API_KEY,
+// CORTEX_BATCH_SIZE, CORTEX_MAX_CONNECTIONS, CORTEX_TIMEOUT_MS y CORTEX_CACHE; lo que no esté definido
+// queda por defecto.
+struct CortexConfig {
+    std::string endpoint = "https://7m15gatms9.execute-api.us-east-1.amazonaws.com/v1/embeddings";
+    std::string apiKey;             // vacío: no se envía x-api-key
+    size_t batchSize = 1;           // imágenes por petición; con más de 1 el servicio responde una línea por imagen
+    size_t maxConnections = 4;      // conexiones persistentes hacia el servicio
+    long timeoutMs = 30000;
+    std::string cachePath = "../embeddings.cache";     // vacío: sin caché de embeddings
+
+    static CortexConfig fromEnvironment();
+};
 
+// Cliente del servicio de embeddings. Todas las peticiones pasan por un único curl multi atendido por un
+// hilo propio: las conexiones (y sus sesiones TLS) se reutilizan entre peticiones y varias peticiones
+// pueden estar en vuelo a la vez. Antes de ir al servicio se consulta la caché por contenido de la imagen.
 class CortexAPI {
 private:
+    using Embeddings = std::vector<std::vector<NType>>;
+
+    struct Request {
+        std::vector<std::string> imagePaths;
+        std::promise<Embeddings> result;
+        std::string response;
+        std::string contentType;
+        curl_mime* form = nullptr;
+        CURL* handle = nullptr;
+    };
+
+    CortexConfig config;
+    CURLM* multi = nullptr;
+    curl_slist* headers = nullptr;
+    std::vector<CURL*> idleHandles;     // handles ya configurados, con su conexión viva
+    std::deque<Request*> pending;       // peticiones aún no agregadas al multi
+    std::vector<Request*> inFlight;     // peticiones agregadas al multi (solo las toca el hilo del multi)
+    std::mutex mutex;
+    bool stopping = false;
+    std::thread worker;
+    std::unique_ptr<EmbeddingCache> cache;
+
+    bool cacheKey(const std::string& imagePath, EmbeddingCache::Key& key) const;
+
     static size_t WriteCallback(void* contents, size_t size, size_t nmemb, void* userp);
+    static Embeddings parseEmbeddings(const std::string& response, const std::string& contentType, size_t expected);
+
+    void run();
+    void start(Request* request);
+    void finish(Request* request, CURLcode code);
+    std::future<Embeddings> submit(std::vector<std::string> imagePaths);
 
 public:
-    CortexAPI();
+    CortexAPI(const CortexConfig& config = CortexConfig::fromEnvironment());
     ~CortexAPI();
 
+    CortexAPI(const CortexAPI&) = delete;
+    CortexAPI& operator=(const CortexAPI&) = delete;
+
     std::vector<NType> postImage(const std::string& imagePath);
+    // El future no debe sobrevivir al CortexAPI: al resolverse guarda el resultado en la caché
+    std::future<std::vector<NType>> postImageAsync(const std::string& imagePath);
+    // Embeddings en el mismo orden que imagePaths; los lotes de config.batchSize viajan en paralelo
+    std::vector<std::vector<NType>> postImages(const std::vector<std::string>& imagePaths);
 };
 
 #endif // CORTEX_API_H
-
-
@@ -0,0 +1,234 @@
+#include "EmbeddingCache.h"
+
+#include <cstring>
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static const char CACHE_MAGIC[4] = {'S', 'S', 'E', 'C'};
+static const uint32_t CACHE_VERSION = 1;
+static const size_t INITIAL_CAPACITY = 1024;
+
+EmbeddingCache::EmbeddingCache(const std::string& fileName) : fileName(fileName) {
+    fd = open(fileName.c_str(), O_RDWR);
+    if (fd < 0) {
+        return;     // se crea con la primera escritura, cuando se conoce la dimensión
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0 || static_cast<size_t>(info.st_size) < sizeof(Header)) {
+        close();
+        return;
+    }
+    remap(static_cast<size_t>(info.st_size));
+    const Header* h = header();
+    bool valid = std::memcmp(h->magic, CACHE_MAGIC, sizeof(CACHE_MAGIC)) == 0 && h->version == CACHE_VERSION &&
+                 h->capacity > 0 && sizeof(Header) + h->capacity * slotBytes() == length;
+    if (!valid) {
+        close();    // archivo de otra versión o reconstrucción interrumpida: se empieza de nuevo
+    }
+}
+
+EmbeddingCache::~EmbeddingCache() {
+    close();
+}
+
+void EmbeddingCache::close() {
+    if (data) {
+        munmap(data, length);
+        data = nullptr;
+        length = 0;
+    }
+    if (fd >= 0) {
+        ::close(fd);
+        fd = -1;
+    }
+}
+
+size_t EmbeddingCache::slotBytes() const {
+    return 2 * sizeof(uint64_t) + header()->dim * sizeof(float);
+}
+
+unsigned char* EmbeddingCache::slot(size_t index) const {
+    return data + sizeof(Header) + index * slotBytes();
+}
+
+void EmbeddingCache::remap(size_t newLength) {
+    if (data) {
+        munmap(data, length);
+        data = nullptr;
+    }
+    if (ftruncate(fd, static_cast<off_t>(newLength)) != 0) {
+        throw std::runtime_error("Cannot resize embedding cache: " + fileName);
+    }
+    void* mapped = mmap(nullptr, newLength, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (mapped == MAP_FAILED) {
+        throw std::runtime_error("Cannot map embedding cache: " + fileName);
+    }
+    data = static_cast<unsigned char*>(mapped);
+    length = newLength;
+}
+
+void EmbeddingCache::create(size_t dim, size_t capacity) {
+    if (fd < 0) {
+        fd = open(fileName.c_str(), O_RDWR | O_CREAT, 0644);
+        if (fd < 0) {
+            throw std::runtime_error("Cannot create embedding cache: " + fileName);
+        }
+    }
+    size_t slot = 2 * sizeof(uint64_t) + dim * sizeof(float);
+    // Se trunca a 0 primero para que las ranuras nuevas queden en cero (vacías)
+    if (ftruncate(fd, 0) != 0) {
+        throw std::runtime_error("Cannot resize embedding cache: " + fileName);
+    }
+    remap(sizeof(Header) + capacity * slot);
+    Header* h = header();
+    std::memcpy(h->magic, CACHE_MAGIC, sizeof(CACHE_MAGIC));
+    h->version = CACHE_VERSION;
+    h->dim = dim;
+    h->capacity = capacity;
+    h->count = 0;
+}
+
+EmbeddingCache::Key EmbeddingCache::keyOfBytes(const void* bytes, size_t size) {
+    // FNV-1a sobre palabras de 8 bytes: ocho veces menos multiplicaciones que byte a byte
+    const unsigned char* p = static_cast<const unsigned char*>(bytes);
+    const uint64_t PRIME = 1099511628211ULL;
+    uint64_t hash = 1469598103934665603ULL ^ size;
+    size_t i = 0;
+    for (; i + sizeof(uint64_t) <= size; i += sizeof(uint64_t)) {
+        uint64_t word;
+        std::memcpy(&word, p + i, sizeof(word));
+        hash = (hash ^ word) * PRIME;
+        hash ^= hash >> 32;
+    }
+    for (; i < size; ++i) {
+        hash = (hash ^ p[i]) * PRIME;
+    }
+    Key key;
+    key.hash = hash == 0 ? 1 : hash;    // 0 marca ranura vacía
+    key.size = size;
+    return key;
+}
+
+EmbeddingCache::Key EmbeddingCache::keyOfFile(const std::string& path) {
+    int file = open(path.c_str(), O_RDONLY);
+    if (file < 0) {
+        throw std::runtime_error("Cannot open image: " + path);
+    }
+    struct stat info;
+    if (fstat(file, &info) != 0) {
+        ::close(file);
+        throw std::runtime_error("Cannot stat image: " + path);
+    }
+    size_t size = static_cast<size_t>(info.st_size);
+    if (size == 0) {
+        ::close(file);
+        return keyOfBytes(nullptr, 0);
+    }
+    void* mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, file, 0);
+    ::close(file);
+    if (mapped == MAP_FAILED) {
+        throw std::runtime_error("Cannot map image: " + path);
+    }
+    Key key = keyOfBytes(mapped, size);
+    munmap(mapped, size);
+    return key;
+}
+
+// Ranura con la clave o, si no está, la primera vacía de su secuencia de sondeo
+size_t EmbeddingCache::findSlot(const Key& key) const {
+    size_t capacity = header()->capacity;
+    size_t index = key.hash % capacity;
+    while (true) {
+        uint64_t stored[2];
+        std::memcpy(stored, slot(index), sizeof(stored));
+        if (stored[0] == 0 || (stored[0] == key.hash && stored[1] == key.size)) {
+            return index;
+        }
+        index = (index + 1) % capacity;
+    }
+}
+
+bool EmbeddingCache::get(const Key& key, std::vector<NType>& embedding) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!data) {
+        return false;
+    }
+    unsigned char* entry = slot(findSlot(key));
+    uint64_t stored;
+    std::memcpy(&stored, entry, sizeof(stored));
+    if (stored == 0) {
+        return false;
+    }
+    size_t dim = header()->dim;
+    const unsigned char* values = entry + 2 * sizeof(uint64_t);
+    embedding.resize(dim);
+    for (size_t i = 0; i < dim; ++i) {
+        float value;
+        std::memcpy(&value, values + i * sizeof(float), sizeof(float));
+        embedding[i] = value;
+    }
+    return true;
+}
+
+void EmbeddingCache::grow() {
+    size_t dim = header()->dim;
+    size_t capacity = header()->capacity;
+    size_t bytes = slotBytes();
+    std::vector<unsigned char> entries;
+    for (size_t i = 0; i < capacity; ++i) {
+        uint64_t stored;
+        std::memcpy(&stored, slot(i), sizeof(stored));
+        if (stored != 0) {
+            entries.insert(entries.end(), slot(i), slot(i) + bytes);
+        }
+    }
+
+    // La versión 0 marca la tabla como inválida mientras se reconstruye
+    header()->version = 0;
+    create(dim, capacity * 2);
+    header()->version = 0;
+    for (size_t offset = 0; offset < entries.size(); offset += bytes) {
+        Key key;
+        std::memcpy(&key.hash, entries.data() + offset, sizeof(uint64_t));
+        std::memcpy(&key.size, entries.data() + offset + sizeof(uint64_t), sizeof(uint64_t));
+        std::memcpy(slot(findSlot(key)), entries.data() + offset, bytes);
+        ++header()->count;
+    }
+    header()->version = CACHE_VERSION;
+}
+
+void EmbeddingCache::put(const Key& key, const std::vector<NType>& embedding) {
+    if (embedding.empty()) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!data || header()->dim != embedding.size()) {
+        create(embedding.size(), INITIAL_CAPACITY);
+    }
+    if ((header()->count + 1) * 2 > header()->capacity) {
+        grow();
+    }
+
+    unsigned char* entry = slot(findSlot(key));
+    uint64_t stored;
+    std::memcpy(&stored, entry, sizeof(stored));
+    // Valores primero y la clave al final: una ranura a medio escribir sigue leyéndose como vacía
+    unsigned char* values = entry + 2 * sizeof(uint64_t);
+    for (size_t i = 0; i < embedding.size(); ++i) {
+        float value = embedding[i].getValue();
+        std::memcpy(values + i * sizeof(float), &value, sizeof(float));
+    }
+    std::memcpy(entry + sizeof(uint64_t), &key.size, sizeof(key.size));
+    std::memcpy(entry, &key.hash, sizeof(key.hash));
+    if (stored == 0) {
+        ++header()->count;
+    }
+}
+
+size_t EmbeddingCache::size() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return data ? header()->count : 0;
+}
@@ -0,0 +1,67 @@
+#ifndef EMBEDDING_CACHE_H
+#define EMBEDDING_CACHE_H
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "params.h"
+
+// Caché persistente de embeddings indexada por el contenido de la imagen. El archivo es una tabla hash
+// de direccionamiento abierto mapeada en memoria: una consulta es un hash de los bytes de la imagen y
+// unas pocas lecturas del mapeo, sin red. Las ranuras son de tamaño fijo (clave, tamaño de la imagen y
+// dim floats); la tabla duplica su capacidad al pasar la mitad de ocupación.
+// Es segura entre hilos de un proceso; dos procesos no deben escribir el mismo archivo a la vez.
+class EmbeddingCache {
+public:
+    struct Key {
+        uint64_t hash = 0;
+        uint64_t size = 0;
+    };
+
+private:
+    struct Header {
+        char magic[4];
+        uint32_t version;
+        uint64_t dim;
+        uint64_t capacity;
+        uint64_t count;
+    };
+
+    std::string fileName;
+    int fd = -1;
+    unsigned char* data = nullptr;
+    size_t length = 0;
+    mutable std::mutex mutex;
+
+    Header* header() const {
+        return reinterpret_cast<Header*>(data);
+    }
+    size_t slotBytes() const;
+    unsigned char* slot(size_t index) const;
+    size_t findSlot(const Key& key) const;
+    void create(size_t dim, size_t capacity);
+    void remap(size_t newLength);
+    void grow();
+    void close();
+
+public:
+    explicit EmbeddingCache(const std::string& fileName);
+    ~EmbeddingCache();
+
+    EmbeddingCache(const EmbeddingCache&) = delete;
+    EmbeddingCache& operator=(const EmbeddingCache&) = delete;
+
+    // Lanza std::runtime_error si el archivo no se puede leer
+    static Key keyOfFile(const std::string& path);
+    static Key keyOfBytes(const void* bytes, size_t size);
+
+    bool get(const Key& key, std::vector<NType>& embedding) const;
+    // Un embedding de otra dimensión (el servicio cambió de modelo) vacía la caché
+    void put(const Key& key, const std::vector<NType>& embedding);
+
+    size_t size() const;
+};
+
+#endif // EMBEDDING_CACHE_H
@@ -1,12 +1,37 @@
 #include <SFML/Graphics.hpp>
 #include <vector>
 #include <sstream>
+#include <future>
+#include <chrono>
+#include <list>
+#include <memory>
+#include <atomic>
+#include <mutex>
+#include <cstdlib>
+#include <unordered_map>
 #include <SFML/Network.hpp>
 
 #include "tinyfiledialogs.h"
 
 #include "SStree.h"
+#include "SegmentedSsTree.h"
 #include "CortexAPI.h"
+#include "ThreadPool.h"
+#include "ThumbnailStore.h"
+#include "Metrics.h"
+#include "VectorFile.h"
+
+// Fuente compartida por todos los textos de la interfaz: se lee del disco una sola vez
+static const sf::Font &sharedFont() {
+    static const sf::Font font = [] {
+        sf::Font loaded;
+        if (!loaded.loadFromFile("../content/Ubuntu-M.ttf")) {
+            std::cerr << "No se pudo cargar la fuente!" << std::endl;
+        }
+        return loaded;
+    }();
+    return font;
+}
 
 class Button {
 public:
@@ -19,11 +44,7 @@ public:
         shape.setOutlineThickness(2.0f);
         shape.setOutlineColor(sf::Color::Black);
         
-        font = sf::Font();
-        if (!font.loadFromFile("../content/Ubuntu-M.ttf")) {
-            std::cerr << "No se pudo cargar la fuente!" << std::endl;
-        }
-        buttonText.setFont(font);
+        buttonText.setFont(sharedFont());
         buttonText.setString(text);
         buttonText.setCharacterSize(14);
         buttonText.setFillColor(sf::Color::Black);
@@ -43,20 +64,19 @@ public:
         }
         return false;
     }
-    
-    void draw(sf::RenderWindow &window) {
-        if (shape.getGlobalBounds().contains(sf::Mouse::getPosition(window).x, sf::Mouse::getPosition(window).y)) {
-            if (!isHovered) {
-                isHovered = true;
-                shape.setFillColor(sf::Color(200, 200, 200));  
-            }
-        } else {
-            if (isHovered) {
-                isHovered = false;
-                shape.setFillColor(sf::Color::White);
-            }
+
+    // Actualiza el resaltado con la posición del ratón; devuelve true si cambió (hay que redibujar)
+    bool updateHover(int x, int y) {
+        bool inside = shape.getGlobalBounds().contains(x, y);
+        if (inside == isHovered) {
+            return false;
         }
-        
+        isHovered = inside;
+        shape.setFillColor(isHovered ? sf::Color(200, 200, 200) : sf::Color::White);
+        return true;
+    }
+    
+    void draw(sf::RenderWindow &window) const {
         window.draw(shape);
         window.draw(buttonText);
     }
@@ -74,7 +94,6 @@ public:
 private:
     sf::RectangleShape shape;
     sf::Text buttonText;
-    sf::Font font;
     bool isHovered;
 
     void centerText() {
@@ -86,6 +105,49 @@ private:
 };
 
 
+// Texturas de miniaturas por ruta, con expulsión de la menos usada recientemente. Las texturas viven en
+// los nodos de la lista, así que los punteros entregados siguen válidos hasta que se expulsan: la
+// capacidad tiene que superar la cantidad de resultados en pantalla.
+class TextureCache {
+public:
+    explicit TextureCache(size_t capacity) : capacity(capacity) {}
+
+    const sf::Texture* get(const std::string &path) {
+        auto it = positions.find(path);
+        if (it == positions.end()) {
+            return nullptr;
+        }
+        entries.splice(entries.begin(), entries, it->second);
+        return &it->second->second;
+    }
+
+    // rgba tiene side*side pixeles
+    const sf::Texture* put(const std::string &path, const unsigned char *rgba, unsigned side) {
+        if (const sf::Texture *cached = get(path)) {
+            return cached;
+        }
+        entries.emplace_front(path, sf::Texture());
+        sf::Texture &texture = entries.front().second;
+        if (!texture.create(side, side)) {
+            entries.pop_front();
+            return nullptr;
+        }
+        texture.update(rgba);
+        texture.setSmooth(true);
+        positions[path] = entries.begin();
+        if (entries.size() > capacity) {
+            positions.erase(entries.back().first);
+            entries.pop_back();
+        }
+        return &texture;
+    }
+
+private:
+    std::list<std::pair<std::string, sf::Texture>> entries;
+    std::unordered_map<std::string, std::list<std::pair<std::string, sf::Texture>>::iterator> positions;
+    size_t capacity;
+};
+
 
 class ImageSearchApp {
 public:
@@ -94,25 +156,54 @@ public:
 
 private:
     void init();
-    void processEvents();
+    void handleEvent(const sf::Event &event);
     void render();
 
     void loadImage();
     void searchImages();
+    bool collectResults();
+    bool collectIndex();
+    bool waitingForResults() const;
+    void setStatus(const std::string &text);
+    const sf::Texture* storedThumbnail(const std::string &path);
+    void showResult(size_t index, const sf::Texture &texture);
     void resizeSpriteTo(sf::Sprite &sprite, float width, float height);
 
 private:
     sf::RenderWindow window;
     sf::Texture selectedTexture;
     sf::Sprite selectedSprite;
-    std::vector<sf::Texture> resultTextures;
+    // Un sprite por resultado, en orden de cercanía; no tiene textura hasta que llega su miniatura
     std::vector<sf::Sprite> resultSprites;
-    SsTree sstree;
+    // Miniaturas precalculadas por ss_tree_thumbnails; sin ellas se decodifica la imagen original
+    std::unique_ptr<ThumbnailStore> thumbnails;
+    TextureCache textureCache;
+    // Se carga en segundo plano mientras la ventana ya responde; nulo hasta que termina
+    std::unique_ptr<SegmentedSsTree> sstree;
+    std::atomic<float> loadProgress{0};
+    int shownProgress = -1;
+    bool searchQueued = false;     // búsqueda pedida antes de que el índice estuviera listo
+    sf::Text statusText;
     CortexAPI cortex;
+    // Con SSTREE_QUERY_LOG definida, cada embedding consultado se agrega a ese .fvecs para reproducir la
+    // carga después con ss_tree_replay
+    std::unique_ptr<VectorWriter> queryLog;
+    std::mutex queryLogMutex;
     Button selectButton;
     Button searchButton;
     bool imageSelected = false;
-    char const *filepath_of_selected_image = NULL;
+    std::string filepath_of_selected_image;
+    // Solo se redibuja cuando algo cambió: en reposo la interfaz no consume CPU
+    bool dirty = true;
+
+    // Búsqueda en segundo plano: embedding y kNN en una tarea, decodificación de cada resultado en otras.
+    // Las texturas solo se crean en el hilo de render (el que tiene el contexto OpenGL).
+    // Se declara después de sstree y cortex para que sus tareas terminen antes de destruirlos.
+    ThreadPool workers;
+    std::future<std::unique_ptr<SegmentedSsTree>> pendingIndex;
+    std::future<std::vector<std::string>> pendingSearch;
+    std::vector<std::string> searchedPaths;
+    std::vector<std::future<std::vector<unsigned char>>> pendingImages;
 };
 
 
@@ -125,60 +216,114 @@ void ImageSearchApp::init() {
 
 ImageSearchApp::ImageSearchApp() 
     : window(sf::VideoMode(1200, 800), "Buscador de Imágenes"),
+      textureCache(128),
       selectButton(10, 10, 100, 50, "Seleccionar"),
-      searchButton(120, 10, 100, 50, "Buscar") { 
-    sstree.loadFromFile("../embbeding.dat");
-    cout<<sstree.nivel0()<<endl;
-    cout<<sstree.nivel1()<<endl;
+      searchButton(120, 10, 100, 50, "Buscar"),
+      workers(std::max(2u, std::thread::hardware_concurrency())) {
+    statusText.setFont(sharedFont());
+    statusText.setCharacterSize(14);
+    statusText.setFillColor(sf::Color::Black);
+    statusText.setPosition(340, 50);
+    setStatus("Cargando índice...");
+
+    // Incluye las altas de ../embbeding.dat.delta que todavía no se compactaron. Solo lectura: la
+    // interfaz no reescribe el registro ni compacta, y puede abrirse mientras ss_tree_indexing --append corre
+    pendingIndex = workers.submit([this]() {
+        return std::make_unique<SegmentedSsTree>("../embbeding.dat", 4096, SsTreeParams(),
+                                                 [this](size_t bytesRead, size_t totalBytes) {
+            loadProgress = totalBytes > 0 ? static_cast<float>(bytesRead) / totalBytes : 1.0f;
+        }, SegmentedSsTree::OpenMode::ReadOnly);
+    });
+    try {
+        thumbnails = std::make_unique<ThumbnailStore>("../thumbnails.dat");
+        cout<<thumbnails->size()<<" miniaturas precalculadas"<<endl;
+    } catch (std::exception &e) {
+        cout<<"Sin miniaturas precalculadas ("<<e.what()<<"); se decodificarán las imágenes"<<endl;
+    }
+    if (const char *logPath = std::getenv("SSTREE_QUERY_LOG")) {
+        try {
+            queryLog = std::make_unique<VectorWriter>(logPath, true);
+        } catch (std::exception &e) {
+            std::cerr << e.what() << std::endl;
+        }
+    }
+    // Una consulta que tarda más de 50 ms se explica en la consola con sus contadores
+    MetricsRegistry::global().setSlowQueryHook(50000000, [](const QueryStats &stats) {
+        std::cerr<<"Consulta lenta: "<<stats<<std::endl;
+    });
     init();
 }
 
 void ImageSearchApp::run() {
+    window.setFramerateLimit(60);
+    sf::Event event;
     while (window.isOpen()) {
-        processEvents();
-        render();
+        // Sin nada que redibujar ni esperar, el hilo duerme hasta el próximo evento de la ventana;
+        // con una búsqueda en curso se revisa cada pocos milisegundos si llegaron resultados
+        if (!dirty && !waitingForResults() && window.waitEvent(event)) {
+            handleEvent(event);
+        }
+        while (window.pollEvent(event)) {
+            handleEvent(event);
+        }
+        if (collectIndex()) {
+            dirty = true;
+        }
+        if (collectResults()) {
+            dirty = true;
+        }
+        if (dirty) {
+            render();
+            dirty = false;
+        } else if (waitingForResults()) {
+            sf::sleep(sf::milliseconds(10));
+        }
     }
+    // Resumen de las búsquedas de la sesión
+    MetricsRegistry::global().dump(std::cout);
 }
 
-void ImageSearchApp::processEvents() {
-    sf::Event event;
-    while (window.pollEvent(event)) {
-        if (event.type == sf::Event::Closed) {
+void ImageSearchApp::handleEvent(const sf::Event &event) {
+    switch (event.type) {
+        case sf::Event::Closed:
             window.close();
+            return;
+        case sf::Event::Resized:
+        case sf::Event::GainedFocus:
+            dirty = true;
+            return;
+        case sf::Event::MouseMoved: {
+            // Sin cortocircuito: los dos botones tienen que enterarse del movimiento
+            bool changed = selectButton.updateHover(event.mouseMove.x, event.mouseMove.y);
+            changed = searchButton.updateHover(event.mouseMove.x, event.mouseMove.y) || changed;
+            dirty = dirty || changed;
+            return;
         }
-        if (selectButton.isClicked(event)) {
-            loadImage();
-        }
-        if (searchButton.isClicked(event) && imageSelected) { 
-            searchImages();
-        }
+        default:
+            break;
+    }
+    if (selectButton.isClicked(event)) {
+        loadImage();
+        dirty = true;
+    }
+    if (searchButton.isClicked(event) && imageSelected) { 
+        searchImages();
     }
 }
 
+// Las posiciones y escalas se calculan al cambiar las texturas, no en cada cuadro
 void ImageSearchApp::render() {
     window.clear(sf::Color(200, 200, 200));
 
-    resizeSpriteTo(selectedSprite, 400, 400);
-    selectedSprite.setPosition(10, 90);
-
-    int xPos  = 420;
-    int yPos  = 90; 
-    int index = 0;
-
     for (const auto &sprite : resultSprites) {
-        resizeSpriteTo(resultSprites[index], 200, 200);
-        resultSprites[index].setPosition(xPos, yPos);
-        window.draw(resultSprites[index]);
-        index++;
-        xPos += 210; 
-        if (index % 3 == 0) {
-            xPos = 420;
-            yPos += 210;
+        if (sprite.getTexture()) {
+            window.draw(sprite);
         }
     }
 
     selectButton.draw(window);  
     searchButton.draw(window);
+    window.draw(statusText);
     window.display();
 }
 
@@ -188,31 +333,158 @@ void ImageSearchApp::loadImage() {
     const char* filepath = tinyfd_openFileDialog("Selecciona una imagen", "", 3, filters, NULL, 0);
 
     if (filepath && selectedTexture.loadFromFile(filepath)) {
-        selectedSprite.setTexture(selectedTexture);
+        selectedSprite.setTexture(selectedTexture, true);
+        resizeSpriteTo(selectedSprite, 400, 400);
+        selectedSprite.setPosition(10, 90);
         imageSelected = true;
-        filepath_of_selected_image = filepath;  
+        filepath_of_selected_image = filepath;  // tinyfd reutiliza su buffer en cada diálogo
     }
 }
 
 void ImageSearchApp::searchImages() {
+    if (imageSelected && !sstree) {
+        // Se lanza en cuanto termine la carga
+        searchQueued = true;
+        return;
+    }
     if (imageSelected) { 
-        std::vector<NType> imageVec = cortex.postImage(filepath_of_selected_image);
-        auto point = Point(imageVec);
-        auto paths = sstree.kNNQuery(point, 6);
-
-        resultTextures.clear();
-        resultSprites.clear();
-        
-        for (const auto &path : paths) {
-            sf::Texture texture;
-            if (texture.loadFromFile(path)) {
-                resultTextures.push_back(texture);
-                sf::Sprite sprite(texture);
-                resultSprites.push_back(sprite);
+        // Una búsqueda nueva reemplaza a la anterior: sus resultados ya no se recogen
+        std::string imagePath = filepath_of_selected_image;
+        SegmentedSsTree *index = sstree.get();
+        pendingSearch = workers.submit([this, index, imagePath]() {
+            QueryClock::time_point start = QueryClock::now();
+            std::vector<NType> imageVec = cortex.postImage(imagePath);
+            MetricsRegistry::global().histogram("cortex.embedding_ns").record(nanosSince(start));
+            if (imageVec.empty()) {
+                return std::vector<std::string>();
+            }
+            auto point = Point(std::move(imageVec));
+            if (queryLog) {
+                std::lock_guard<std::mutex> lock(queryLogMutex);
+                queryLog->write(point);
             }
+            QueryStats stats;
+            std::vector<std::string> paths = index->kNNQuery(point, 6, &stats);
+            MetricsRegistry::global().recordQuery(stats);
+            return paths;
+        });
+        pendingImages.clear();
+    }
+}
+
+// Textura de la caché o, si está en el almacén de miniaturas, creada copiando sus pixeles mapeados
+const sf::Texture* ImageSearchApp::storedThumbnail(const std::string &path) {
+    if (const sf::Texture *cached = textureCache.get(path)) {
+        return cached;
+    }
+    if (thumbnails) {
+        if (const unsigned char *pixels = thumbnails->find(path)) {
+            return textureCache.put(path, pixels, thumbnails->side());
+        }
+    }
+    return nullptr;
+}
+
+void ImageSearchApp::setStatus(const std::string &text) {
+    statusText.setString(text);
+    dirty = true;
+}
+
+// Avance de la carga del índice y, cuando termina, habilita las búsquedas. Devuelve true si cambió algo visible
+bool ImageSearchApp::collectIndex() {
+    if (!pendingIndex.valid()) {
+        return false;
+    }
+    if (pendingIndex.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+        int percent = static_cast<int>(loadProgress * 100);
+        if (percent == shownProgress) {
+            return false;
+        }
+        shownProgress = percent;
+        setStatus("Cargando índice... " + std::to_string(percent) + "%");
+        return true;
+    }
+
+    try {
+        sstree = pendingIndex.get();
+    } catch (std::exception &e) {
+        std::cerr << "No se pudo cargar el índice: " << e.what() << std::endl;
+        setStatus("No se pudo cargar el índice");
+        return true;
+    }
+    cout<<sstree->size()<<" imágenes indexadas ("<<sstree->pendingSize()<<" en segmentos delta)"<<endl;
+    setStatus(std::to_string(sstree->size()) + " imágenes indexadas");
+    if (searchQueued) {
+        searchQueued = false;
+        searchImages();
+    }
+    return true;
+}
+
+bool ImageSearchApp::waitingForResults() const {
+    if (pendingIndex.valid() || pendingSearch.valid()) {
+        return true;
+    }
+    return std::any_of(pendingImages.begin(), pendingImages.end(), [](const auto &future) {
+        return future.valid();
+    });
+}
+
+// Tres resultados por fila a la derecha de la imagen seleccionada
+void ImageSearchApp::showResult(size_t index, const sf::Texture &texture) {
+    sf::Sprite &sprite = resultSprites[index];
+    sprite.setTexture(texture, true);
+    resizeSpriteTo(sprite, 200, 200);
+    sprite.setPosition(420 + (index % 3) * 210, 90 + (index / 3) * 210);
+}
+
+// Sin bloquear: recoge lo que ya terminó en los hilos de trabajo. Devuelve true si cambió algo visible
+bool ImageSearchApp::collectResults() {
+    auto ready = [](const auto &future) {
+        return future.valid() && future.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+    };
+    unsigned side = thumbnails ? thumbnails->side() : 200;
+    bool changed = false;
+
+    if (ready(pendingSearch)) {
+        changed = true;
+        std::vector<std::string> paths = pendingSearch.get();
+        resultSprites.assign(paths.size(), sf::Sprite());
+        pendingImages.clear();
+        pendingImages.resize(paths.size());
+        for (size_t i = 0; i < paths.size(); ++i) {
+            const std::string &path = paths[i];
             cout << path << endl;
+            if (const sf::Texture *texture = storedThumbnail(path)) {
+                showResult(i, *texture);
+                continue;
+            }
+            // Imagen que no está en el almacén (p. ej. agregada después de generarlo): se decodifica
+            // y se reduce en un hilo de trabajo
+            pendingImages[i] = workers.submit([path, side]() {
+                sf::Image image;
+                if (!image.loadFromFile(path)) {
+                    return std::vector<unsigned char>();
+                }
+                return ThumbnailStore::downscale(image.getPixelsPtr(), image.getSize().x, image.getSize().y, side);
+            });
+        }
+        searchedPaths = std::move(paths);
+    }
+
+    for (size_t i = 0; i < pendingImages.size(); ++i) {
+        if (ready(pendingImages[i])) {
+            std::vector<unsigned char> pixels = pendingImages[i].get();
+            if (pixels.empty()) {
+                continue;
+            }
+            if (const sf::Texture *texture = textureCache.put(searchedPaths[i], pixels.data(), side)) {
+                showResult(i, *texture);
+                changed = true;
+            }
         }
     }
+    return changed;
 }
 
 
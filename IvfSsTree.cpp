@@ -0,0 +1,174 @@
+#include "IvfSsTree.h"
+
+#include <atomic>
+#include <future>
+#include <stdexcept>
+#include <thread>
+
+IvfSsTree::IvfSsTree(size_t nlist, const SsTreeParams& params, size_t nprobe)
+    : listSizes(std::max<size_t>(nlist, 1), 0), params(params), nprobe(std::max<size_t>(nprobe, 1)) {
+    for (size_t i = 0; i < listSizes.size(); ++i) {
+        lists.emplace_back(params);
+    }
+}
+
+void IvfSsTree::train(const std::vector<Point>& sample, const KMeansParams& kmeans) {
+    if (size() > 0) {
+        throw std::runtime_error("No se puede reentrenar un índice con puntos");
+    }
+    centroids = trainKMeans(sample, lists.size(), kmeans);
+    D = centroids[0].dim();
+    // Con menos puntos que clusters k-means devuelve menos centroides
+    lists.resize(centroids.size());
+    listSizes.resize(centroids.size());
+}
+
+void IvfSsTree::build(std::vector<Point>&& points) {
+    if (points.empty()) {
+        return;
+    }
+    if (!isTrained()) {
+        train(points);
+    }
+
+    std::vector<std::vector<Point>> parts(lists.size());
+    for (Point& point : points) {
+        parts[nearestCentroid(centroids, point)].push_back(std::move(point));
+    }
+    points.clear();
+
+    // Hay muchas más listas que núcleos: cada hilo toma la siguiente lista pendiente
+    std::atomic<size_t> next(0);
+    std::vector<std::future<void>> workers;
+    size_t threads = std::max(1u, std::thread::hardware_concurrency());
+    for (size_t t = 0; t < std::min(threads, lists.size()); ++t) {
+        workers.push_back(std::async(std::launch::async, [this, &parts, &next]() {
+            for (size_t list = next++; list < lists.size(); list = next++) {
+                listSizes[list] += parts[list].size();
+                lists[list].build(std::move(parts[list]));
+            }
+        }));
+    }
+    for (std::future<void>& worker : workers) {
+        worker.get();
+    }
+}
+
+void IvfSsTree::insert(Point point, const std::string& path) {
+    if (!isTrained()) {
+        throw std::runtime_error("El índice IVF necesita entrenarse antes de insertar");
+    }
+    point.path = "../" + path;
+    size_t list = nearestCentroid(centroids, point);
+    lists[list].insert(std::move(point));
+    ++listSizes[list];
+}
+
+std::vector<Neighbor> IvfSsTree::kNNSearch(const Point& center, size_t k, QueryStats* stats) const {
+    return kNNSearch(center, k, nprobe, stats);
+}
+
+std::vector<Neighbor> IvfSsTree::kNNSearch(const Point& center, size_t k, size_t probes, QueryStats* stats) const {
+    std::vector<Neighbor> result;
+    if (!isTrained() || k == 0) {
+        return result;
+    }
+    QueryClock::time_point start = QueryClock::now();
+    uint64_t total = stats ? stats->totalNanos : 0;
+    NeighborHeap L;
+    NType Dk = std::numeric_limits<float>::max();
+    std::vector<size_t> probed = nearestCentroids(centroids, center, probes);
+    if (stats) {
+        stats->distanceComputations += centroids.size();
+        stats->routeNanos += nanosSince(start);
+    }
+    for (size_t list : probed) {
+        lists[list].kNNSearch(center, k, L, Dk, stats);
+    }
+    if (stats) {
+        // Las listas no sondeadas cuentan como subárboles descartados
+        stats->prunedSubtrees += lists.size() - probed.size();
+        stats->totalNanos = total + nanosSince(start);
+    }
+
+    result.resize(L.size());
+    for (size_t i = result.size(); i-- > 0; L.pop()) {
+        result[i] = {L.top().point->path, L.top().distance};
+    }
+    return result;
+}
+
+std::vector<std::string> IvfSsTree::kNNQuery(const Point& center, size_t k, QueryStats* stats) const {
+    std::vector<std::string> paths;
+    for (Neighbor& neighbor : kNNSearch(center, k, stats)) {
+        paths.push_back(std::move(neighbor.path));
+    }
+    return paths;
+}
+
+size_t IvfSsTree::size() const {
+    size_t total = 0;
+    for (size_t count : listSizes) {
+        total += count;
+    }
+    return total;
+}
+
+void IvfSsTree::forEachPoint(const std::function<void(const Point&)>& visit) const {
+    for (const SsTree& list : lists) {
+        list.forEachPoint(visit);
+    }
+}
+
+void IvfSsTree::saveToFile(const std::string& fileName) const {
+    std::ofstream out(fileName, std::ios::binary);
+    if (!out) {
+        throw std::runtime_error("Cannot open file for writing");
+    }
+    size_t listCount = lists.size();
+    size_t centroidCount = centroids.size();
+    out.write(reinterpret_cast<const char*>(&D), sizeof(D));
+    out.write(reinterpret_cast<const char*>(&nprobe), sizeof(nprobe));
+    out.write(reinterpret_cast<const char*>(&listCount), sizeof(listCount));
+    out.write(reinterpret_cast<const char*>(&centroidCount), sizeof(centroidCount));
+    for (const Point& centroid : centroids) {
+        centroid.saveToFile(out, D);
+    }
+    // Una lista vacía no tiene raíz: basta con su tamaño 0
+    for (size_t list = 0; list < listCount; ++list) {
+        out.write(reinterpret_cast<const char*>(&listSizes[list]), sizeof(listSizes[list]));
+        if (listSizes[list] > 0) {
+            lists[list].saveToStream(out);
+        }
+    }
+}
+
+void IvfSsTree::loadFromFile(const std::string& fileName) {
+    std::ifstream in(fileName, std::ios::binary);
+    if (!in) {
+        throw std::runtime_error("Cannot open file for reading");
+    }
+    size_t listCount = 0;
+    size_t centroidCount = 0;
+    in.read(reinterpret_cast<char*>(&D), sizeof(D));
+    in.read(reinterpret_cast<char*>(&nprobe), sizeof(nprobe));
+    in.read(reinterpret_cast<char*>(&listCount), sizeof(listCount));
+    in.read(reinterpret_cast<char*>(&centroidCount), sizeof(centroidCount));
+    centroids.assign(centroidCount, Point(D));
+    for (Point& centroid : centroids) {
+        centroid.readFromFile(in, D);
+    }
+
+    lists.clear();
+    listSizes.assign(listCount, 0);
+    for (size_t list = 0; list < listCount; ++list) {
+        lists.emplace_back(params);
+        in.read(reinterpret_cast<char*>(&listSizes[list]), sizeof(listSizes[list]));
+        if (listSizes[list] > 0) {
+            lists[list].loadFromStream(in);
+        }
+    }
+    if (!in) {
+        throw std::runtime_error("Invalid IVF index: " + fileName);
+    }
+}
@@ -0,0 +1,59 @@
+#ifndef IVF_SSTREE_H
+#define IVF_SSTREE_H
+
+#include <string>
+#include <vector>
+
+#include "SStree.h"
+#include "KMeans.h"
+
+// Índice de listas invertidas: un cuantizador k-means reparte los puntos en nlist clusters y cada cluster
+// es un SsTree. Una consulta solo recorre los nprobe clusters cuyos centroides están más cerca, del más
+// cercano al más lejano y con un único heap de candidatos, así que los primeros clusters ya podan los
+// siguientes. Con nprobe = nlist la respuesta es exacta; con menos se cambia exactitud por trabajo.
+class IvfSsTree {
+private:
+    std::vector<Point> centroids;
+    std::vector<SsTree> lists;
+    std::vector<size_t> listSizes;
+    SsTreeParams params;
+    size_t nprobe;
+    size_t D = 0;
+
+public:
+    explicit IvfSsTree(size_t nlist, const SsTreeParams& params = SsTreeParams(), size_t nprobe = 8);
+
+    // Entrena el cuantizador; build lo llama con los propios puntos si aún no se entrenó
+    void train(const std::vector<Point>& sample, const KMeansParams& kmeans = KMeansParams());
+    void build(std::vector<Point>&& points);
+    void insert(Point point, const std::string& path);
+
+    std::vector<Neighbor> kNNSearch(const Point& center, size_t k, QueryStats* stats = nullptr) const;
+    std::vector<Neighbor> kNNSearch(const Point& center, size_t k, size_t nprobe, QueryStats* stats = nullptr) const;
+    // Rutas de los k vecinos más cercanos, del más cercano al más lejano
+    std::vector<std::string> kNNQuery(const Point& center, size_t k, QueryStats* stats = nullptr) const;
+
+    void setNprobe(size_t value) {
+        nprobe = std::max<size_t>(value, 1);
+    }
+    size_t getNprobe() const {
+        return nprobe;
+    }
+    size_t listCount() const {
+        return lists.size();
+    }
+    size_t listSize(size_t index) const {
+        return listSizes[index];
+    }
+    bool isTrained() const {
+        return !centroids.empty();
+    }
+    size_t size() const;
+    void forEachPoint(const std::function<void(const Point&)>& visit) const;
+
+    // Centroides y todas las listas en un solo archivo
+    void saveToFile(const std::string& fileName) const;
+    void loadFromFile(const std::string& fileName);
+};
+
+#endif // IVF_SSTREE_H
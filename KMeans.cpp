@@ -0,0 +1,110 @@
+#include "KMeans.h"
+
+#include <algorithm>
+#include <random>
+#include <stdexcept>
+
+static float squaredDistance(const Point& a, const Point& b) {
+    return squaredDistance(a.data(), b.data(), a.dim());
+}
+
+std::vector<Point> trainKMeans(const std::vector<Point>& points, size_t k, const KMeansParams& params) {
+    if (points.empty() || k == 0) {
+        throw std::runtime_error("k-means needs at least one point and one cluster");
+    }
+    std::mt19937 gen(params.seed);
+
+    std::vector<const Point*> sample;
+    sample.reserve(points.size());
+    for (const Point& point : points) {
+        sample.push_back(&point);
+    }
+    if (params.sampleSize != 0 && sample.size() > params.sampleSize) {
+        std::shuffle(sample.begin(), sample.end(), gen);
+        sample.resize(params.sampleSize);
+    }
+    k = std::min(k, sample.size());
+    size_t n = sample.size();
+
+    // Siembra k-means++: cada centroide nuevo se elige con probabilidad proporcional a la distancia al cuadrado
+    std::vector<Point> centroids;
+    centroids.reserve(k);
+    centroids.push_back(*sample[std::uniform_int_distribution<size_t>(0, n - 1)(gen)]);
+    std::vector<float> closest(n);
+    for (size_t i = 0; i < n; ++i) {
+        closest[i] = squaredDistance(*sample[i], centroids[0]);
+    }
+    while (centroids.size() < k) {
+        std::discrete_distribution<size_t> pick(closest.begin(), closest.end());
+        centroids.push_back(*sample[pick(gen)]);
+        for (size_t i = 0; i < n; ++i) {
+            closest[i] = std::min(closest[i], squaredDistance(*sample[i], centroids.back()));
+        }
+    }
+
+    std::vector<size_t> assignment(n, k);
+    std::vector<size_t> counts(k);
+    for (size_t iteration = 0; iteration < params.iterations; ++iteration) {
+        bool changed = false;
+        for (size_t i = 0; i < n; ++i) {
+            size_t nearest = nearestCentroid(centroids, *sample[i]);
+            if (nearest != assignment[i]) {
+                assignment[i] = nearest;
+                changed = true;
+            }
+        }
+        if (!changed) {
+            break;
+        }
+
+        for (Point& centroid : centroids) {
+            centroid.setZero(centroid.dim());
+        }
+        std::fill(counts.begin(), counts.end(), 0);
+        for (size_t i = 0; i < n; ++i) {
+            centroids[assignment[i]] += *sample[i];
+            ++counts[assignment[i]];
+        }
+        for (size_t c = 0; c < k; ++c) {
+            if (counts[c] > 0) {
+                centroids[c] /= counts[c];
+            } else {
+                // Un cluster vacío se reinicia en un punto al azar de la muestra
+                centroids[c] = *sample[std::uniform_int_distribution<size_t>(0, n - 1)(gen)];
+            }
+        }
+    }
+    for (Point& centroid : centroids) {
+        centroid.path.clear();
+    }
+    return centroids;
+}
+
+size_t nearestCentroid(const std::vector<Point>& centroids, const Point& point) {
+    size_t nearest = 0;
+    float best = squaredDistance(centroids[0], point);
+    for (size_t c = 1; c < centroids.size(); ++c) {
+        float d = squaredDistance(centroids[c], point);
+        if (d < best) {
+            best = d;
+            nearest = c;
+        }
+    }
+    return nearest;
+}
+
+std::vector<size_t> nearestCentroids(const std::vector<Point>& centroids, const Point& point, size_t n) {
+    std::vector<std::pair<float, size_t>> ranked;
+    ranked.reserve(centroids.size());
+    for (size_t c = 0; c < centroids.size(); ++c) {
+        ranked.emplace_back(squaredDistance(centroids[c], point), c);
+    }
+    n = std::min(n, ranked.size());
+    std::partial_sort(ranked.begin(), ranked.begin() + n, ranked.end());
+
+    std::vector<size_t> result(n);
+    for (size_t i = 0; i < n; ++i) {
+        result[i] = ranked[i].second;
+    }
+    return result;
+}
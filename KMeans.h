@@ -0,0 +1,25 @@
+#ifndef KMEANS_H
+#define KMEANS_H
+
+#include <cstdint>
+#include <vector>
+
+#include "Point.h"
+
+// Cuantizador grueso: k-means de Lloyd con siembra k-means++ sobre una muestra de los puntos.
+// Se usa para repartir puntos entre árboles independientes, no dentro de un nodo (ver SsNode::kMeansSplit).
+struct KMeansParams {
+    size_t iterations = 20;
+    size_t sampleSize = 100000;     // puntos usados para entrenar; 0 usa todos
+    uint32_t seed = 42;
+};
+
+std::vector<Point> trainKMeans(const std::vector<Point>& points, size_t k, const KMeansParams& params = KMeansParams());
+
+// Índice del centroide más cercano a point
+size_t nearestCentroid(const std::vector<Point>& centroids, const Point& point);
+
+// Índices de los n centroides más cercanos a point, del más cercano al más lejano
+std::vector<size_t> nearestCentroids(const std::vector<Point>& centroids, const Point& point, size_t n);
+
+#endif // KMEANS_H
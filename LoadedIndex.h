@@ -0,0 +1,69 @@
+#ifndef LOADED_INDEX_H
+#define LOADED_INDEX_H
+
+#include <functional>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "SStree.h"
+#include "ShardedSsTree.h"
+#include "IvfSsTree.h"
+
+// Tipo con el que ss_tree_indexing construyó el archivo: el formato no lo guarda
+enum class IndexType { Tree, Sharded, Ivf };
+
+inline IndexType parseIndexType(const std::string& type) {
+    if (type == "tree") return IndexType::Tree;
+    if (type == "sharded") return IndexType::Sharded;
+    if (type == "ivf") return IndexType::Ivf;
+    throw std::invalid_argument("Tipo de índice desconocido: " + type);
+}
+
+// Índice cargado detrás de una sola interfaz de consulta, para las herramientas que evalúan cualquiera
+// de los tipos
+struct LoadedIndex {
+    IndexType type = IndexType::Tree;
+    SsTree tree;
+    std::unique_ptr<ShardedSsTree> sharded;
+    std::unique_ptr<IvfSsTree> ivf;
+
+    void load(const std::string& fileName, IndexType indexType) {
+        type = indexType;
+        if (type == IndexType::Ivf) {
+            ivf = std::make_unique<IvfSsTree>(1);
+            ivf->loadFromFile(fileName);
+        } else if (type == IndexType::Sharded) {
+            sharded = std::make_unique<ShardedSsTree>(1);
+            sharded->loadFromFile(fileName);
+        } else {
+            tree.loadFromFile(fileName);
+        }
+    }
+
+    void forEachPoint(const std::function<void(const Point&)>& visit) const {
+        if (ivf) {
+            ivf->forEachPoint(visit);
+        } else if (sharded) {
+            for (size_t s = 0; s < sharded->shardCount(); ++s) {
+                sharded->shard(s).forEachPoint(visit);
+            }
+        } else {
+            tree.forEachPoint(visit);
+        }
+    }
+
+    // nprobe solo se usa con IVF (0 toma el valor guardado en el índice)
+    std::vector<Neighbor> search(const Point& query, size_t k, size_t nprobe, QueryStats* stats) const {
+        if (ivf) {
+            return nprobe > 0 ? ivf->kNNSearch(query, k, nprobe, stats) : ivf->kNNSearch(query, k, stats);
+        }
+        if (sharded) {
+            return sharded->kNNSearch(query, k, stats);
+        }
+        return tree.kNNSearch(query, k, stats);
+    }
+};
+
+#endif // LOADED_INDEX_H
@@ -0,0 +1,154 @@
+#include "Metrics.h"
+
+#include <iomanip>
+
+size_t Histogram::bucketOf(uint64_t value) {
+    if (value < 4) {
+        return value;
+    }
+    // Exponente de la potencia de dos y los dos bits siguientes como subcubeta
+    size_t exponent = 63 - __builtin_clzll(value);
+    size_t sub = (value >> (exponent - 2)) & 3;
+    return 4 * (exponent - 1) + sub;
+}
+
+uint64_t Histogram::bucketUpperBound(size_t bucket) {
+    if (bucket < 4) {
+        return bucket;
+    }
+    size_t exponent = bucket / 4 + 1;
+    uint64_t width = uint64_t(1) << (exponent - 2);
+    uint64_t low = (4 + bucket % 4) * width;
+    return low + (width - 1);
+}
+
+void Histogram::record(uint64_t value) {
+    buckets[bucketOf(value)].fetch_add(1, std::memory_order_relaxed);
+    total.fetch_add(value, std::memory_order_relaxed);
+    uint64_t current = maximum.load(std::memory_order_relaxed);
+    while (value > current && !maximum.compare_exchange_weak(current, value, std::memory_order_relaxed)) {
+    }
+}
+
+uint64_t Histogram::count() const {
+    uint64_t n = 0;
+    for (const std::atomic<uint64_t>& bucket : buckets) {
+        n += bucket.load(std::memory_order_relaxed);
+    }
+    return n;
+}
+
+uint64_t Histogram::sum() const {
+    return total.load(std::memory_order_relaxed);
+}
+
+uint64_t Histogram::max() const {
+    return maximum.load(std::memory_order_relaxed);
+}
+
+double Histogram::mean() const {
+    uint64_t n = count();
+    return n > 0 ? static_cast<double>(sum()) / n : 0.0;
+}
+
+uint64_t Histogram::quantile(double q) const {
+    uint64_t n = count();
+    if (n == 0) {
+        return 0;
+    }
+    uint64_t rank = static_cast<uint64_t>(q * (n - 1)) + 1;
+    uint64_t seen = 0;
+    for (size_t b = 0; b < NUM_BUCKETS; ++b) {
+        seen += buckets[b].load(std::memory_order_relaxed);
+        if (seen >= rank) {
+            // La cubeta del máximo se acota con el máximo exacto
+            return std::min(bucketUpperBound(b), max());
+        }
+    }
+    return max();
+}
+
+void Histogram::reset() {
+    for (std::atomic<uint64_t>& bucket : buckets) {
+        bucket.store(0, std::memory_order_relaxed);
+    }
+    total.store(0, std::memory_order_relaxed);
+    maximum.store(0, std::memory_order_relaxed);
+}
+
+// En el mismo orden que los valores de recordQuery
+static const char* QUERY_METRICS[] = {"knn.total_ns", "knn.route_ns", "knn.scan_ns", "knn.merge_ns",
+                                      "knn.inner_visited", "knn.leaves_visited", "knn.points_scanned",
+                                      "knn.distances", "knn.heap_pushes", "knn.pruned_subtrees"};
+
+MetricsRegistry::MetricsRegistry() {
+    for (size_t i = 0; i < queryHistograms.size(); ++i) {
+        queryHistograms[i] = &histogram(QUERY_METRICS[i]);
+    }
+}
+
+MetricsRegistry& MetricsRegistry::global() {
+    static MetricsRegistry registry;
+    return registry;
+}
+
+Histogram& MetricsRegistry::histogram(const std::string& name) {
+    std::lock_guard<std::mutex> lock(mutex);
+    std::unique_ptr<Histogram>& slot = histograms[name];
+    if (!slot) {
+        slot = std::make_unique<Histogram>();
+    }
+    return *slot;
+}
+
+void MetricsRegistry::dump(std::ostream& out) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    out << std::left << std::setw(28) << "métrica" << std::right << std::setw(10) << "cantidad" << std::setw(14)
+        << "media" << std::setw(12) << "p50" << std::setw(12) << "p90" << std::setw(12) << "p99" << std::setw(12)
+        << "max" << "\n";
+    for (const auto& [name, histogram] : histograms) {
+        out << std::left << std::setw(28) << name << std::right << std::setw(10) << histogram->count()
+            << std::setw(14) << std::fixed << std::setprecision(1) << histogram->mean() << std::setw(12)
+            << histogram->quantile(0.5) << std::setw(12) << histogram->quantile(0.9) << std::setw(12)
+            << histogram->quantile(0.99) << std::setw(12) << histogram->max() << "\n";
+    }
+    out << std::flush;
+}
+
+void MetricsRegistry::reset() {
+    std::lock_guard<std::mutex> lock(mutex);
+    for (auto& entry : histograms) {
+        entry.second->reset();
+    }
+}
+
+void MetricsRegistry::setSlowQueryHook(uint64_t thresholdNanos, std::function<void(const QueryStats&)> hook) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (hook) {
+        slowHook = std::make_shared<const std::function<void(const QueryStats&)>>(std::move(hook));
+        slowThreshold = thresholdNanos;
+    } else {
+        slowHook.reset();
+        slowThreshold = UINT64_MAX;
+    }
+}
+
+void MetricsRegistry::recordQuery(const QueryStats& stats) {
+    const uint64_t values[] = {stats.totalNanos, stats.routeNanos, stats.scanNanos, stats.mergeNanos,
+                               stats.innerVisited, stats.leavesVisited, stats.pointsScanned,
+                               stats.distanceComputations, stats.heapPushes, stats.prunedSubtrees};
+    for (size_t i = 0; i < queryHistograms.size(); ++i) {
+        queryHistograms[i]->record(values[i]);
+    }
+
+    if (stats.totalNanos >= slowThreshold.load(std::memory_order_relaxed)) {
+        std::shared_ptr<const std::function<void(const QueryStats&)>> hook;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            hook = slowHook;
+        }
+        if (hook) {
+            (*hook)(stats);
+        }
+    }
+}
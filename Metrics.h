@@ -0,0 +1,73 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include "SStree.h"
+
+// Histograma de valores enteros (nanosegundos, nodos, distancias...) sin locks: cuatro cubetas por
+// cada potencia de dos, así un cuantil se estima con un error relativo de a lo sumo 25%. Registrar un
+// valor son dos sumas atómicas y un máximo.
+class Histogram {
+public:
+    static const size_t NUM_BUCKETS = 252;
+
+    void record(uint64_t value);
+
+    uint64_t count() const;
+    uint64_t sum() const;
+    uint64_t max() const;
+    double mean() const;
+    // Cota superior de la cubeta que contiene el cuantil q (0..1)
+    uint64_t quantile(double q) const;
+    void reset();
+
+    static size_t bucketOf(uint64_t value);
+    static uint64_t bucketUpperBound(size_t bucket);
+
+private:
+    std::array<std::atomic<uint64_t>, NUM_BUCKETS> buckets{};
+    std::atomic<uint64_t> total{0};
+    std::atomic<uint64_t> maximum{0};
+};
+
+// Registro de histogramas con nombre, compartido por todo el proceso. Los histogramas no se borran
+// nunca: la referencia que devuelve histogram() se puede guardar y usar desde cualquier hilo.
+class MetricsRegistry {
+public:
+    MetricsRegistry();
+
+    static MetricsRegistry& global();
+
+    Histogram& histogram(const std::string& name);
+
+    // Una línea por histograma: nombre, cantidad, media, p50, p90, p99 y máximo
+    void dump(std::ostream& out) const;
+    void reset();
+
+    // Llamada con las estadísticas de cada consulta registrada que tarde al menos thresholdNanos
+    // (nullptr la desactiva). Sirve para explicar una consulta lenta puntual.
+    void setSlowQueryHook(uint64_t thresholdNanos, std::function<void(const QueryStats&)> hook);
+
+    // Registra una consulta kNN en los histogramas "knn.*" y avisa al hook de consultas lentas
+    void recordQuery(const QueryStats& stats);
+
+private:
+    mutable std::mutex mutex;
+    std::map<std::string, std::unique_ptr<Histogram>> histograms;
+    // Los histogramas de recordQuery se buscan una vez: registrar una consulta no toma el mutex
+    std::array<Histogram*, 10> queryHistograms;
+
+    std::atomic<uint64_t> slowThreshold{UINT64_MAX};
+    std::shared_ptr<const std::function<void(const QueryStats&)>> slowHook;
+};
+
+#endif // METRICS_H
@@ -3,11 +3,79 @@
 
 #include "params.h"
 #include <vector>
+#include <array>
 #include <cmath>
 #include <iostream>
 #include <sstream>
+#include <utility>
 using namespace std;
 
+// Dimensiones con núcleos de distancia especializados en tiempo de compilación
+// (se pueden cambiar con -DSSTREE_FIXED_DIMS=512,768)
+#ifndef SSTREE_FIXED_DIMS
+#define SSTREE_FIXED_DIMS 2, 3, 50, 128, 256, 512, 768, 1024, 2048
+#endif
+using FixedDims = std::index_sequence<SSTREE_FIXED_DIMS>;
+
+// Número de acumuladores independientes: permite al compilador vectorizar la suma
+constexpr size_t DISTANCE_LANES = 8;
+
+// Distancia euclidiana al cuadrado con la dimensión conocida al compilar
+template <size_t N>
+inline float squaredDistanceFixed(const NType* a, const NType* b) {
+    float acc[DISTANCE_LANES] = {};
+    for (size_t i = 0; i + DISTANCE_LANES <= N; i += DISTANCE_LANES) {
+        for (size_t l = 0; l < DISTANCE_LANES; ++l) {
+            float diff = a[i + l].getValue() - b[i + l].getValue();
+            acc[l] += diff * diff;
+        }
+    }
+    float sum = 0;
+    for (size_t i = N - N % DISTANCE_LANES; i < N; ++i) {
+        float diff = a[i].getValue() - b[i].getValue();
+        sum += diff * diff;
+    }
+    for (size_t l = 0; l < DISTANCE_LANES; ++l) {
+        sum += acc[l];
+    }
+    return sum;
+}
+
+// Misma distancia con la dimensión conocida solo en ejecución
+inline float squaredDistanceRuntime(const NType* a, const NType* b, size_t D) {
+    float acc[DISTANCE_LANES] = {};
+    size_t i = 0;
+    for (; i + DISTANCE_LANES <= D; i += DISTANCE_LANES) {
+        for (size_t l = 0; l < DISTANCE_LANES; ++l) {
+            float diff = a[i + l].getValue() - b[i + l].getValue();
+            acc[l] += diff * diff;
+        }
+    }
+    float sum = 0;
+    for (; i < D; ++i) {
+        float diff = a[i].getValue() - b[i].getValue();
+        sum += diff * diff;
+    }
+    for (size_t l = 0; l < DISTANCE_LANES; ++l) {
+        sum += acc[l];
+    }
+    return sum;
+}
+
+template <size_t... Ns>
+inline bool squaredDistanceDispatch(std::index_sequence<Ns...>, const NType* a, const NType* b, size_t D, float& result) {
+    return ((D == Ns && (result = squaredDistanceFixed<Ns>(a, b), true)) || ...);
+}
+
+// Usa el núcleo especializado si D está en FixedDims y el genérico en otro caso
+inline float squaredDistance(const NType* a, const NType* b, size_t D) {
+    float result = 0;
+    if (!squaredDistanceDispatch(FixedDims{}, a, b, D, result)) {
+        result = squaredDistanceRuntime(a, b, D);
+    }
+    return result;
+}
+
 
 class Point {
 private:
@@ -17,7 +85,11 @@ public:
     Point() {}
     Point(size_t size) : coordinates(size) {}
     Point(std::initializer_list<NType> init) : coordinates(init) {}
-    Point(std::vector<NType> coordinates) : coordinates(coordinates) {}
+    Point(std::vector<NType> coordinates) : coordinates(std::move(coordinates)) {}
+    Point(const Point&) = default;
+    Point(Point&&) noexcept = default;
+    Point& operator=(const Point&) = default;
+    Point& operator=(Point&&) noexcept = default;
     string path;
 
     // Acceso a las coordenadas
@@ -42,28 +114,28 @@ public:
     }
 
     // Operaciones
-    Point operator+(const Point& other) const {
+    Point operator+(const Point& other) const & {
         Point result(dim());
         for (size_t i = 0; i < dim(); ++i) {
             result[i] = coordinates[i] + other.coordinates[i];
         }
         return result;
     }
-    Point operator-(const Point& other) const {
+    Point operator-(const Point& other) const & {
         Point result(dim());
         for (size_t i = 0; i < dim(); ++i) {
             result[i] = coordinates[i] - other.coordinates[i];
         }
         return result;
     }
-    Point operator*(NType scalar) const {
+    Point operator*(NType scalar) const & {
         Point result(dim());
         for (size_t i = 0; i < dim(); ++i) {
             result[i] = coordinates[i] * scalar;
         }
         return result;
     }
-    Point operator/(NType scalar) const {
+    Point operator/(NType scalar) const & {
         Point result(dim());
         for (size_t i = 0; i < dim(); ++i) {
             result[i] = coordinates[i] / scalar;
@@ -71,6 +143,28 @@ public:
         return result;
     }
 
+    // Sobre temporales se reutiliza su memoria: (a + b) + c reserva una sola vez
+    Point operator+(const Point& other) && {
+        *this += other;
+        path.clear();
+        return std::move(*this);
+    }
+    Point operator-(const Point& other) && {
+        *this -= other;
+        path.clear();
+        return std::move(*this);
+    }
+    Point operator*(NType scalar) && {
+        *this *= scalar;
+        path.clear();
+        return std::move(*this);
+    }
+    Point operator/(NType scalar) && {
+        *this /= scalar;
+        path.clear();
+        return std::move(*this);
+    }
+
     // Operadores de asignación
     Point& operator+=(const Point& other) {
         for (size_t i = 0; i < dim(); ++i) {
@@ -97,10 +191,27 @@ public:
         return *this;
     }
 
+    // Operaciones in situ: evitan crear puntos temporales
+    Point& axpy(NType alpha, const Point& x) {  // this += alpha * x
+        for (size_t i = 0; i < dim(); ++i) {
+            coordinates[i] += x.coordinates[i] * alpha;
+        }
+        return *this;
+    }
+    void setZero(size_t size) {  // reutiliza la memoria ya reservada
+        coordinates.assign(size, NType(0));
+    }
+
     // Funciones auxiliares
     size_t dim() const {
         return coordinates.size();
     }
+    const NType* data() const {
+        return coordinates.data();
+    }
+    NType* data() {
+        return coordinates.data();
+    }
     NType norm() const {
         NType result = 0;
         for (size_t i = 0; i < dim(); ++i) {
@@ -161,11 +272,7 @@ inline NType distance(const Point& a, const Point& b) {
     if (a.dim() != b.dim()) {
         throw std::runtime_error("Los puntos deben tener la misma dimensión");
     }
-    NType sum = 0;
-    for (auto it1 = a.begin(), it2 = b.begin(); it1 != a.end(); ++it1, ++it2) {
-        sum = sum + (*it1 - *it2) * (*it1 - *it2);
-    }
-    return NType::sqrt(sum);
+    return NType(std::sqrt(squaredDistance(a.data(), b.data(), a.dim())));
 }
 inline NType manhattanDistance(const Point& a, const Point& b) {
     if (a.dim() != b.dim()) {
@@ -202,4 +309,119 @@ inline NType minkowskiDistance(const Point& a, const Point& b, int p) {
 }
 
 
+// Punto con la dimensión fijada al compilar: sin reserva dinámica ni comprobaciones de dimensión
+template <size_t N>
+class FixedPoint {
+private:
+    std::array<NType, N> coordinates{};
+
+public:
+    FixedPoint() = default;
+    FixedPoint(std::initializer_list<NType> init) {
+        std::copy(init.begin(), init.begin() + std::min(init.size(), N), coordinates.begin());
+    }
+    explicit FixedPoint(const Point& point) {
+        if (point.dim() != N) {
+            throw std::runtime_error("El punto no tiene la dimensión esperada");
+        }
+        std::copy(point.begin(), point.end(), coordinates.begin());
+    }
+
+    Point toPoint() const {
+        return Point(std::vector<NType>(coordinates.begin(), coordinates.end()));
+    }
+
+    // Acceso a las coordenadas
+    const NType& operator[](size_t index) const {
+        return coordinates[index];
+    }
+    NType& operator[](size_t index) {
+        return coordinates[index];
+    }
+
+    // Operaciones
+    FixedPoint operator+(const FixedPoint& other) const {
+        FixedPoint result = *this;
+        return result += other;
+    }
+    FixedPoint operator-(const FixedPoint& other) const {
+        FixedPoint result = *this;
+        return result -= other;
+    }
+    FixedPoint operator*(NType scalar) const {
+        FixedPoint result = *this;
+        return result *= scalar;
+    }
+    FixedPoint operator/(NType scalar) const {
+        FixedPoint result = *this;
+        return result /= scalar;
+    }
+
+    // Operadores de asignación
+    FixedPoint& operator+=(const FixedPoint& other) {
+        for (size_t i = 0; i < N; ++i) {
+            coordinates[i] += other.coordinates[i];
+        }
+        return *this;
+    }
+    FixedPoint& operator-=(const FixedPoint& other) {
+        for (size_t i = 0; i < N; ++i) {
+            coordinates[i] -= other.coordinates[i];
+        }
+        return *this;
+    }
+    FixedPoint& operator*=(NType scalar) {
+        for (size_t i = 0; i < N; ++i) {
+            coordinates[i] *= scalar;
+        }
+        return *this;
+    }
+    FixedPoint& operator/=(NType scalar) {
+        for (size_t i = 0; i < N; ++i) {
+            coordinates[i] /= scalar;
+        }
+        return *this;
+    }
+
+    // Funciones auxiliares
+    static constexpr size_t dim() {
+        return N;
+    }
+    const NType* data() const {
+        return coordinates.data();
+    }
+    NType* data() {
+        return coordinates.data();
+    }
+    NType norm() const {
+        float sum = 0;
+        for (size_t i = 0; i < N; ++i) {
+            sum += coordinates[i].getValue() * coordinates[i].getValue();
+        }
+        return NType(std::sqrt(sum));
+    }
+
+    // Iteradores para recorrer las coordenadas
+    using iterator = typename std::array<NType, N>::iterator;
+    using const_iterator = typename std::array<NType, N>::const_iterator;
+    iterator begin() {
+        return coordinates.begin();
+    }
+    const_iterator begin() const {
+        return coordinates.begin();
+    }
+    iterator end() {
+        return coordinates.end();
+    }
+    const_iterator end() const {
+        return coordinates.end();
+    }
+};
+
+template <size_t N>
+inline NType distance(const FixedPoint<N>& a, const FixedPoint<N>& b) {
+    return NType(std::sqrt(squaredDistanceFixed<N>(a.data(), b.data())));
+}
+
+
 #endif // !POINT_H
\ No newline at end of file
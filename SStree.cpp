@@ -1,35 +1,51 @@
 #include "SStree.h"
+
+#include <atomic>
+#include <cstring>
+#include <iomanip>
+#include <mutex>
+#include <thread>
 const long long inf = 1e18;
 
 
-NType SsNode::varianceAlongDirection(const std::vector<Point>& values, size_t direction) const {
+NType SsNode::varianceAlongDirection(const std::vector<const Point*>& values, size_t direction) const {
     NType mean = 0;
-    for (const Point& value : values) {
-        mean += value[direction];
+    for (const Point* value : values) {
+        mean += (*value)[direction];
     }
     mean /= values.size();
 
     NType variance = 0;
-    for (const Point& value : values) {
-        variance += pow(value[direction] - mean, 2);
+    for (const Point* value : values) {
+        variance += pow((*value)[direction] - mean, 2);
     }
     variance /= values.size();
 
     return variance;
 }
 
-size_t SsNode::minVarianceSplit(size_t coordinateIndex){
-    size_t splitIndex = Settings::m;
+size_t SsNode::minVarianceSplit(size_t coordinateIndex, size_t minEntries){
+    size_t splitIndex = minEntries;
     NType minVariance = inf;
-    vector<Point> points = getEntriesCentroids();
-
-    for (size_t i = Settings::m; i <= Settings::M - Settings::m; ++i) {
-        std::vector<Point> left(points.begin(), points.begin() + i);
-        std::vector<Point> right(points.begin() + i, points.end());
+    std::vector<const Point*> points = getEntriesCentroids();
+    size_t n = points.size();
+
+    // Sumas acumuladas de la coordenada y de su cuadrado: la varianza de cada lado se obtiene sin copiar entradas
+    std::vector<double> sum(n + 1, 0);
+    std::vector<double> sumSquares(n + 1, 0);
+    for (size_t i = 0; i < n; ++i) {
+        double value = (*points[i])[coordinateIndex].getValue();
+        sum[i + 1] = sum[i] + value;
+        sumSquares[i + 1] = sumSquares[i] + value * value;
+    }
+    auto rangeVariance = [&sum, &sumSquares](size_t begin, size_t end) {
+        double count = static_cast<double>(end - begin);
+        double mean = (sum[end] - sum[begin]) / count;
+        return static_cast<float>((sumSquares[end] - sumSquares[begin]) / count - mean * mean);
+    };
 
-        NType leftVariance = varianceAlongDirection(left, coordinateIndex);
-        NType rightVariance = varianceAlongDirection(right, coordinateIndex);
-        NType variance = leftVariance + rightVariance;
+    for (size_t i = minEntries; i + 1 + minEntries <= n; ++i) {
+        NType variance = rangeVariance(0, i) + rangeVariance(i, n);
 
         if (variance < minVariance) {
             minVariance = variance;
@@ -41,11 +57,11 @@ size_t SsNode::minVarianceSplit(size_t coordinateIndex){
 }
 
 size_t SsNode::directionOfMaxVariance() const { 
-    std::vector<Point> centroids = getEntriesCentroids();
+    std::vector<const Point*> centroids = getEntriesCentroids();
 
     size_t direction = 0;
     NType maxVariance = 0;
-    for (size_t i = 0; i < centroids[0].dim(); ++i) {
+    for (size_t i = 0; i < centroids[0]->dim(); ++i) {
         NType variance = varianceAlongDirection(centroids, i);
         if (variance > maxVariance) {
             maxVariance = variance;
@@ -56,17 +72,186 @@ size_t SsNode::directionOfMaxVariance() const {
     return direction;
 }
 
-size_t SsNode::findSplitIndex() {
+// Esfera envolvente de las entradas order[begin, end)
+static void boundingSphere(const std::vector<const Point*>& centroids, const std::vector<NType>& radii,
+                           const std::vector<size_t>& order, size_t begin, size_t end,
+                           Point& center, NType& radius) {
+    center.setZero(centroids[0]->dim());
+    for (size_t i = begin; i < end; ++i) {
+        center += *centroids[order[i]];
+    }
+    center /= (end - begin);
+
+    radius = 0;
+    for (size_t i = begin; i < end; ++i) {
+        NType d = distance(center, *centroids[order[i]]) + radii[order[i]];
+        if (d > radius) {
+            radius = d;
+        }
+    }
+}
+
+// Ocupación mínima que admite un corte de n entradas con al menos una a cada lado. Las capacidades
+// validadas ya la cumplen; acotarla evita que un corte vacío descarte entradas
+static size_t feasibleMinEntries(size_t minEntries, size_t n) {
+    return std::max<size_t>(1, std::min(minEntries, n / 2));
+}
+
+size_t SsNode::minOverlapSplit(size_t minEntries) {
+    const size_t CANDIDATE_AXES = 4;
+    std::vector<const Point*> centroids = getEntriesCentroids();
+    std::vector<NType> radii = getEntriesRadii();
+    size_t n = centroids.size();
+    minEntries = feasibleMinEntries(minEntries, n);
+
+    // Solo se evalúan las direcciones de mayor varianza: probar todas es prohibitivo en alta dimensión
+    std::vector<std::pair<NType, size_t>> variances;
+    for (size_t i = 0; i < centroids[0]->dim(); ++i) {
+        variances.push_back({varianceAlongDirection(centroids, i), i});
+    }
+    size_t numAxes = std::min(CANDIDATE_AXES, variances.size());
+    std::partial_sort(variances.begin(), variances.begin() + numAxes, variances.end(),
+                      [](const auto& a, const auto& b) { return a.first > b.first; });
+
+    // Sin candidato mejor se corta en el orden actual
+    std::vector<size_t> bestOrder(n);
+    for (size_t i = 0; i < n; ++i) {
+        bestOrder[i] = i;
+    }
+    size_t bestCount = minEntries;
+    NType bestOverlap = inf;
+    NType bestRadiusSum = inf;
+    Point leftCenter, rightCenter;
+    for (size_t a = 0; a < numAxes; ++a) {
+        size_t axis = variances[a].second;
+        std::vector<size_t> order(n);
+        for (size_t i = 0; i < n; ++i) {
+            order[i] = i;
+        }
+        std::sort(order.begin(), order.end(), [&centroids, axis](size_t x, size_t y) {
+            return (*centroids[x])[axis] < (*centroids[y])[axis];
+        });
+
+        for (size_t count = minEntries; count <= n - minEntries; ++count) {
+            NType leftRadius, rightRadius;
+            boundingSphere(centroids, radii, order, 0, count, leftCenter, leftRadius);
+            boundingSphere(centroids, radii, order, count, n, rightCenter, rightRadius);
+
+            NType overlap = leftRadius + rightRadius - distance(leftCenter, rightCenter);
+            if (overlap < 0) {
+                overlap = 0;
+            }
+            NType radiusSum = leftRadius + rightRadius;
+
+            // Menor solapamiento y, a igualdad, menor volumen (aproximado por la suma de radios)
+            if (overlap < bestOverlap || (overlap == bestOverlap && radiusSum < bestRadiusSum)) {
+                bestOverlap = overlap;
+                bestRadiusSum = radiusSum;
+                bestCount = count;
+                bestOrder = order;
+            }
+        }
+    }
+
+    reorderEntries(bestOrder);
+    return bestCount - 1;
+}
+
+size_t SsNode::kMeansSplit(size_t minEntries) {
+    const size_t MAX_ITERATIONS = 10;
+    std::vector<const Point*> centroids = getEntriesCentroids();
+    size_t n = centroids.size();
+    minEntries = feasibleMinEntries(minEntries, n);
+
+    Point mean(centroids[0]->dim());
+    for (const Point* c : centroids) {
+        mean += *c;
+    }
+    mean /= n;
+
+    // Semillas: la entrada más alejada del centro y la más alejada de ésta
+    size_t seedA = 0;
+    for (size_t i = 1; i < n; ++i) {
+        if (distance(mean, *centroids[i]) > distance(mean, *centroids[seedA])) {
+            seedA = i;
+        }
+    }
+    size_t seedB = seedA == 0 ? 1 : 0;
+    for (size_t i = 0; i < n; ++i) {
+        if (distance(*centroids[seedA], *centroids[i]) > distance(*centroids[seedA], *centroids[seedB])) {
+            seedB = i;
+        }
+    }
+    Point centerA = *centroids[seedA];
+    Point centerB = *centroids[seedB];
+
+    std::vector<size_t> order(n);
+    for (size_t i = 0; i < n; ++i) {
+        order[i] = i;
+    }
+    std::vector<bool> inA(n, false);
+    std::vector<NType> preference(n);
+    size_t countA = minEntries;
+    for (size_t iteration = 0; iteration < MAX_ITERATIONS; ++iteration) {
+        // Ordenar por preferencia hacia A; el corte se acota a [m, n - m] para respetar la ocupación mínima
+        countA = 0;
+        for (size_t i = 0; i < n; ++i) {
+            preference[i] = distance(*centroids[i], centerA) - distance(*centroids[i], centerB);
+            if (preference[i].getValue() < 0) {
+                ++countA;
+            }
+        }
+        countA = std::max(minEntries, std::min(countA, n - minEntries));
+        std::sort(order.begin(), order.end(), [&preference](size_t x, size_t y) {
+            return preference[x].getValue() < preference[y].getValue();
+        });
+
+        bool changed = false;
+        for (size_t i = 0; i < n; ++i) {
+            bool assignedToA = i < countA;
+            if (inA[order[i]] != assignedToA) {
+                inA[order[i]] = assignedToA;
+                changed = true;
+            }
+        }
+        if (!changed) {
+            break;
+        }
+
+        centerA.setZero(mean.dim());
+        centerB.setZero(mean.dim());
+        for (size_t i = 0; i < n; ++i) {
+            (i < countA ? centerA : centerB) += *centroids[order[i]];
+        }
+        centerA /= countA;
+        centerB /= (n - countA);
+    }
+
+    reorderEntries(order);
+    return countA - 1;
+}
+
+size_t SsNode::findSplitIndex(const SsTreeParams& params) {
+    switch (params.split) {
+        case SplitPolicy::MinOverlap:
+            return minOverlapSplit(minEntries(params));
+        case SplitPolicy::KMeans:
+            return kMeansSplit(minEntries(params));
+        case SplitPolicy::MaxVariance:
+        default:
+            break;
+    }
     size_t coordinateIndex = directionOfMaxVariance();
     sortEntriesByCoordinate(coordinateIndex);
-    return minVarianceSplit(coordinateIndex);
+    return minVarianceSplit(coordinateIndex, minEntries(params));
 }
 
 
-std::vector<Point> SsInnerNode::getEntriesCentroids() const {
-    std::vector<Point> centroids;
+std::vector<const Point*> SsInnerNode::getEntriesCentroids() const {
+    std::vector<const Point*> centroids;
+    centroids.reserve(children.size());
     for (const SsNode* child : children) {
-        centroids.push_back(child->centroid);
+        centroids.push_back(&child->centroid);
     }
     return centroids;
 }
@@ -77,6 +262,24 @@ void SsInnerNode::sortEntriesByCoordinate(size_t coordinateIndex) {
     });
 }
 
+std::vector<NType> SsInnerNode::getEntriesRadii() const {
+    std::vector<NType> radii;
+    radii.reserve(children.size());
+    for (const SsNode* child : children) {
+        radii.push_back(child->radius);
+    }
+    return radii;
+}
+
+void SsInnerNode::reorderEntries(const std::vector<size_t>& order) {
+    std::vector<SsNode*> reordered;
+    reordered.reserve(order.size());
+    for (size_t index : order) {
+        reordered.push_back(children[index]);
+    }
+    children = std::move(reordered);
+}
+
 SsNode* SsInnerNode::findClosestChild(const Point& target) const { 
     NType minDistance = inf;
     SsNode* closestChild = nullptr;
@@ -91,15 +294,11 @@ SsNode* SsInnerNode::findClosestChild(const Point& target) const {
 }
 
 void SsInnerNode::updateBoundingEnvelope() {
-    vector<Point> points = getEntriesCentroids();
-    this->centroid = Point(points[0].dim());
-    for (size_t i = 0; i < centroid.dim(); ++i) {
-        for (const Point& point : points) {
-            this->centroid[i] += point[i];
-        }
+    this->centroid.setZero(children[0]->centroid.dim());
+    for (const SsNode* child : children) {
+        this->centroid += child->centroid;
     }
-    
-    this->centroid /= points.size();
+    this->centroid /= children.size();
 
     radius = 0;
     for (auto child : children) {
@@ -111,8 +310,13 @@ void SsInnerNode::updateBoundingEnvelope() {
 }
 
 
-std::vector<Point> SsLeaf::getEntriesCentroids() const {
-    return points;
+std::vector<const Point*> SsLeaf::getEntriesCentroids() const {
+    std::vector<const Point*> centroids;
+    centroids.reserve(points.size());
+    for (const Point& point : points) {
+        centroids.push_back(&point);
+    }
+    return centroids;
 }
 
 void SsLeaf::sortEntriesByCoordinate(size_t coordinateIndex) {
@@ -121,14 +325,24 @@ void SsLeaf::sortEntriesByCoordinate(size_t coordinateIndex) {
     });
 }
 
+std::vector<NType> SsLeaf::getEntriesRadii() const {
+    return std::vector<NType>(points.size(), 0);
+}
+
+void SsLeaf::reorderEntries(const std::vector<size_t>& order) {
+    std::vector<Point> reordered;
+    reordered.reserve(order.size());
+    for (size_t index : order) {
+        reordered.push_back(std::move(points[index]));
+    }
+    points = std::move(reordered);
+}
+
 
 void SsLeaf::updateBoundingEnvelope() { 
-    vector<Point> points = getEntriesCentroids();
-    this->centroid = Point(points[0].dim());
-    for (size_t i = 0; i < centroid.dim(); ++i) {
-        for (const Point& point : points) {
-            this->centroid[i] += point[i];
-        }
+    this->centroid.setZero(points[0].dim());
+    for (const Point& point : points) {
+        this->centroid += point;
     }
     this->centroid /= points.size();
 
@@ -141,14 +355,15 @@ void SsLeaf::updateBoundingEnvelope() {
     }
 }
 
-std::pair<SsNode*, SsNode*> SsLeaf::split() {
-    size_t splitIndex = findSplitIndex();
-    std::vector<Point> left(points.begin(), points.begin() + splitIndex + 1);
-    std::vector<Point> right(points.begin() + splitIndex + 1, points.end());
+std::pair<SsNode*, SsNode*> SsLeaf::split(const SsTreeParams& params) {
+    size_t splitIndex = findSplitIndex(params);
     SsLeaf* leftNode = new SsLeaf();
     SsLeaf* rightNode = new SsLeaf();
-    leftNode->points = left;
-    rightNode->points = right;
+
+    // Los puntos se mueven a las hojas nuevas; este nodo queda vacío y lo libera quien lo contiene
+    leftNode->points.assign(std::make_move_iterator(points.begin()), std::make_move_iterator(points.begin() + splitIndex + 1));
+    rightNode->points.assign(std::make_move_iterator(points.begin() + splitIndex + 1), std::make_move_iterator(points.end()));
+    points.clear();
 
     leftNode->updateBoundingEnvelope();
     rightNode->updateBoundingEnvelope();
@@ -156,22 +371,22 @@ std::pair<SsNode*, SsNode*> SsLeaf::split() {
     return std::make_pair(leftNode, rightNode);
 }
 
-std::pair<SsNode*, SsNode*> SsInnerNode::split() {
-    size_t splitIndex = findSplitIndex();
-
-    std::vector<SsNode*> left(children.begin(), children.begin() + splitIndex + 1);
-    std::vector<SsNode*> right(children.begin() + splitIndex + 1, children.end());
+std::pair<SsNode*, SsNode*> SsInnerNode::split(const SsTreeParams& params) {
+    size_t splitIndex = findSplitIndex(params);
 
     SsInnerNode* leftNode = new SsInnerNode();
     SsInnerNode* rightNode = new SsInnerNode();
-    leftNode->children = left;
-    rightNode->children = right;
+    leftNode->children.assign(children.begin(), children.begin() + splitIndex + 1);
+    rightNode->children.assign(children.begin() + splitIndex + 1, children.end());
 
-    for (SsNode* child : left) {
+    // Los hijos pasan a los nodos nuevos; este nodo queda vacío y lo libera quien lo contiene
+    children.clear();
+
+    for (SsNode* child : leftNode->children) {
         child->parent = leftNode;
     }
 
-    for (SsNode* child : right) {
+    for (SsNode* child : rightNode->children) {
         child->parent = rightNode;
     }
 
@@ -182,31 +397,47 @@ std::pair<SsNode*, SsNode*> SsInnerNode::split() {
     return std::make_pair(leftNode, rightNode);
 }
 
-pair<SsNode*,SsNode*> SsInnerNode::insert(const Point& point) {
+pair<SsNode*,SsNode*> SsInnerNode::insert(Point&& point, const SsTreeParams& params, std::vector<Point>* reinsertQueue) {
     SsNode* closestChild = findClosestChild(point);
-    pair<SsNode*,SsNode*> newChilds = closestChild->insert(point);
+    pair<SsNode*,SsNode*> newChilds = closestChild->insert(std::move(point), params, reinsertQueue);
     pair<SsNode*, SsNode*> splitNodes;
     if (newChilds.first != nullptr) {
         children.erase(std::remove(children.begin(), children.end(), closestChild), children.end());
+        delete closestChild;    // sus entradas ya pasaron a los nodos nuevos
         children.push_back(newChilds.first);
         children.push_back(newChilds.second);
-        if (children.size() > Settings::M) {
-            splitNodes = split();
-            splitNodes.first->parent = this;
-            splitNodes.second->parent = this;
+        newChilds.first->parent = this;
+        newChilds.second->parent = this;
+        if (children.size() > params.innerMax) {
+            splitNodes = split(params);
+            splitNodes.first->parent = parent;
+            splitNodes.second->parent = parent;
+            return splitNodes;
         }
     }
-    closestChild->updateBoundingEnvelope();
     updateBoundingEnvelope();
     return splitNodes;
 }
 
-pair<SsNode*, SsNode*> SsLeaf::insert(const Point& point) {
-    points.push_back(point);
+pair<SsNode*, SsNode*> SsLeaf::insert(Point&& point, const SsTreeParams& params, std::vector<Point>* reinsertQueue) {
+    points.push_back(std::move(point));
     updateBoundingEnvelope();
     std::pair<SsNode*, SsNode*> splitNodes;
-    if (points.size() > Settings::M) {
-        splitNodes = split();
+    if (points.size() > params.leafMax) {
+        // La raíz no reinserta: no hay otro nodo que pueda recibir las entradas
+        if (reinsertQueue && parent) {
+            size_t count = static_cast<size_t>(std::lround(params.reinsertFraction * points.size()));
+            count = std::min(std::max(count, size_t(1)), points.size() - params.leafMin);
+
+            std::sort(points.begin(), points.end(), [this](const Point& a, const Point& b) {
+                return distance(centroid, a).getValue() > distance(centroid, b).getValue();
+            });
+            reinsertQueue->insert(reinsertQueue->end(), std::make_move_iterator(points.begin()), std::make_move_iterator(points.begin() + count));
+            points.erase(points.begin(), points.begin() + count);
+            updateBoundingEnvelope();
+            return splitNodes;
+        }
+        splitNodes = split(params);
         splitNodes.first->parent = parent;
         splitNodes.second->parent = parent;
     }
@@ -214,38 +445,31 @@ pair<SsNode*, SsNode*> SsLeaf::insert(const Point& point) {
 }
 
 
-void SsTree::insert(const Point& point){
-    if (!root) {
-        root = new SsLeaf();
-        dynamic_cast<SsLeaf*>(root)->points.push_back(point);
-        root->updateBoundingEnvelope();
-        root->parent = nullptr;
-    }else{
-        pair<SsNode*,SsNode*> newChilds = root->insert(point);
-        if (newChilds.first != nullptr) {
-            root = new SsInnerNode();
-            dynamic_cast<SsInnerNode*>(root)->children.push_back(newChilds.first);
-            newChilds.first->parent = root;
-            dynamic_cast<SsInnerNode*>(root)->children.push_back(newChilds.second);
-            newChilds.second->parent = root;
-            dynamic_cast<SsInnerNode*>(root)->updateBoundingEnvelope();
-            dynamic_cast<SsInnerNode*>(root)->parent = nullptr;
-        }
+// Fija la dimensión con el primer punto y, si se pidió, ajusta las capacidades a ella
+void SsTree::adoptDimension(size_t d){
+    if (D == 0) {
+        D = d;
+    }
+    if (params.nodeBytes != 0) {
+        SsTreeParams sized = SsTreeParams::forDimension(D, params.nodeBytes);
+        params.leafMax = sized.leafMax;
+        params.leafMin = sized.leafMin;
+        params.innerMax = sized.innerMax;
+        params.innerMin = sized.innerMin;
     }
-    //print();
-    //cout<<"----------------------------------------------------------------------------"<<endl;
 }
 
-void SsTree::insert(Point& point, const std::string& path){
-    point.path = "../" + path;
+void SsTree::insertPoint(Point&& point, std::vector<Point>* reinsertQueue){
     if (!root) {
+        adoptDimension(point.dim());
         root = new SsLeaf();
-        dynamic_cast<SsLeaf*>(root)->points.push_back(point);
+        dynamic_cast<SsLeaf*>(root)->points.push_back(std::move(point));
         root->updateBoundingEnvelope();
         root->parent = nullptr;
     }else{
-        pair<SsNode*,SsNode*> newChilds = root->insert(point);
+        pair<SsNode*,SsNode*> newChilds = root->insert(std::move(point), params, reinsertQueue);
         if (newChilds.first != nullptr) {
+            delete root;    // sus entradas ya pasaron a los nodos nuevos
             root = new SsInnerNode();
             dynamic_cast<SsInnerNode*>(root)->children.push_back(newChilds.first);
             newChilds.first->parent = root;
@@ -257,6 +481,29 @@ void SsTree::insert(Point& point, const std::string& path){
     }
 }
 
+void SsTree::insert(const Point& point){
+    insert(Point(point));
+}
+
+void SsTree::insert(Point&& point){
+    if (!params.reinsert) {
+        insertPoint(std::move(point), nullptr);
+        return;
+    }
+
+    // Solo el primer desborde reinserta; las entradas expulsadas ya dividen si vuelven a desbordar
+    std::vector<Point> pending;
+    insertPoint(std::move(point), &pending);
+    for (Point& p : pending) {
+        insertPoint(std::move(p), nullptr);
+    }
+}
+
+void SsTree::insert(Point point, const std::string& path){
+    point.path = "../" + path;
+    insert(std::move(point));
+}
+
 SsNode* SsTree::search(SsNode* node, const Point& target){
     if (node->isLeaf()) {
         return node;
@@ -286,102 +533,533 @@ void SsTree::build(const std::vector<Point>& points){
     }
 }
 
+void SsTree::build(std::vector<Point>&& points){
+    for (Point& point : points) {
+        insert(std::move(point));
+    }
+    points.clear();
+}
+
+// Reparte items[begin, end) en grupos de entre capacity/2 y capacity elementos: cada paso ordena por la
+// coordenada de mayor varianza y corta en proporción al número de grupos que le toca a cada lado
+template <typename T, typename CentroidOf>
+static void packGroups(std::vector<T>& items, size_t begin, size_t end, size_t capacity,
+                       CentroidOf centroidOf, std::vector<size_t>& bounds) {
+    size_t n = end - begin;
+    if (n <= capacity) {
+        bounds.push_back(end);
+        return;
+    }
+
+    size_t dim = centroidOf(items[begin]).dim();
+    std::vector<double> mean(dim, 0.0), squares(dim, 0.0);
+    for (size_t i = begin; i < end; ++i) {
+        const Point& c = centroidOf(items[i]);
+        for (size_t j = 0; j < dim; ++j) {
+            double v = c[j].getValue();
+            mean[j] += v;
+            squares[j] += v * v;
+        }
+    }
+    size_t axis = 0;
+    double maxVariance = -1.0;
+    for (size_t j = 0; j < dim; ++j) {
+        double variance = squares[j] / n - (mean[j] / n) * (mean[j] / n);
+        if (variance > maxVariance) {
+            maxVariance = variance;
+            axis = j;
+        }
+    }
+
+    size_t groups = (n + capacity - 1) / capacity;
+    size_t leftGroups = groups / 2;
+    size_t middle = begin + (n * leftGroups + groups / 2) / groups;
+    std::nth_element(items.begin() + begin, items.begin() + middle, items.begin() + end,
+                     [&](const T& a, const T& b) {
+                         return centroidOf(a)[axis].getValue() < centroidOf(b)[axis].getValue();
+                     });
+    packGroups(items, begin, middle, capacity, centroidOf, bounds);
+    packGroups(items, middle, end, capacity, centroidOf, bounds);
+}
+
+void SsTree::bulkLoad(std::vector<Point>&& points){
+    if (root) {
+        build(std::move(points));
+        return;
+    }
+    if (points.empty()) {
+        return;
+    }
+    adoptDimension(points[0].dim());
+
+    std::vector<size_t> bounds;
+    packGroups(points, 0, points.size(), params.leafMax, [](const Point& p) -> const Point& { return p; }, bounds);
+    std::vector<SsNode*> level;
+    level.reserve(bounds.size());
+    size_t begin = 0;
+    for (size_t end : bounds) {
+        SsLeaf* leaf = new SsLeaf();
+        leaf->points.assign(std::make_move_iterator(points.begin() + begin), std::make_move_iterator(points.begin() + end));
+        leaf->updateBoundingEnvelope();
+        level.push_back(leaf);
+        begin = end;
+    }
+    points.clear();
+
+    // Cada nivel agrupa los centroides del anterior hasta que queda un único nodo
+    while (level.size() > 1) {
+        bounds.clear();
+        packGroups(level, 0, level.size(), params.innerMax, [](SsNode* node) -> const Point& { return node->centroid; }, bounds);
+        std::vector<SsNode*> next;
+        next.reserve(bounds.size());
+        begin = 0;
+        for (size_t end : bounds) {
+            SsInnerNode* inner = new SsInnerNode();
+            inner->children.assign(level.begin() + begin, level.begin() + end);
+            for (SsNode* child : inner->children) {
+                child->parent = inner;
+            }
+            inner->updateBoundingEnvelope();
+            next.push_back(inner);
+            begin = end;
+        }
+        level = std::move(next);
+    }
+    root = level[0];
+    root->parent = nullptr;
+}
 
-void SsLeaf::FNDFTrav(const Point& q, size_t k, std::priority_queue<Pair, std::vector<Pair>, Comparator>& L, NType& Dk) const{
-    Point M = this->centroid;
+void SsLeaf::FNDFTrav(const Point& q, size_t k, std::priority_queue<Pair, std::vector<Pair>, Comparator>& L, NType& Dk, QueryStats* stats) const{
+    QueryClock::time_point start;
+    if (stats) {
+        start = QueryClock::now();
+    }
+    size_t computed = 0;
+    size_t pushes = 0;
+    const Point& M = this->centroid;
+    NType distanceMq = distance(M, q);
     for (const Point& point : points) {
-        if (distance(M,q) - distance(M,point) > Dk) {
+        NType distanceMp = distance(M, point);
+        if (distanceMq - distanceMp > Dk) {
             continue;
-        } else if (distance(M,point) - distance(M,q) > Dk) {
+        } else if (distanceMp - distanceMq > Dk) {
             continue;
         } else {
-            if (distance(point, q) < Dk) {
+            NType distancePq = distance(point, q);
+            ++computed;
+            if (distancePq < Dk) {
                 if (L.size() == k) {
                     L.pop();
                 }
-                Pair p(point, distance(point, q));
-                L.push(p);
+                L.emplace(point, distancePq);
+                ++pushes;
                 if (L.size() == k) {
                     Dk = L.top().distance;
                 }
             }
         }
     }
+    if (stats) {
+        ++stats->leavesVisited;
+        stats->pointsScanned += points.size();
+        stats->distanceComputations += 1 + points.size() + computed;
+        stats->heapPushes += pushes;
+        stats->scanNanos += nanosSince(start);
+    }
 }
 
 
-void SsInnerNode::FNDFTrav(const Point& q, size_t k, std::priority_queue<Pair, std::vector<Pair>, Comparator>& L, NType& Dk) const{
-    for (const SsNode* child : children) { 
-        child->FNDFTrav(q, k, L, Dk);
+void SsInnerNode::FNDFTrav(const Point& q, size_t k, std::priority_queue<Pair, std::vector<Pair>, Comparator>& L, NType& Dk, QueryStats* stats) const{
+    QueryClock::time_point start;
+    if (stats) {
+        ++stats->innerVisited;
+        start = QueryClock::now();
+    }
+
+    // Visitar primero los hijos más cercanos para reducir Dk cuanto antes
+    std::vector<std::pair<NType, const SsNode*>> candidates;
+    candidates.reserve(children.size());
+    for (const SsNode* child : children) {
+        candidates.push_back({distance(child->centroid, q) - child->radius, child});
+    }
+    std::sort(candidates.begin(), candidates.end(), [](const auto& a, const auto& b) {
+        return a.first.getValue() < b.first.getValue();
+    });
+    if (stats) {
+        stats->distanceComputations += children.size();
+        stats->routeNanos += nanosSince(start);
+    }
+
+    for (size_t i = 0; i < candidates.size(); ++i) {
+        // Ningún punto de la esfera del hijo puede mejorar el k-ésimo vecino actual
+        if (candidates[i].first > Dk) {
+            if (stats) {
+                stats->prunedSubtrees += candidates.size() - i;
+            }
+            break;
+        }
+        candidates[i].second->FNDFTrav(q, k, L, Dk, stats);
     }
 }
 
 
-vector<string> SsTree::kNNQuery(const Point& center, size_t k) const{
+vector<string> SsTree::kNNQuery(const Point& center, size_t k, QueryStats* stats) const{
     std::priority_queue<Pair, std::vector<Pair>, Comparator> L;
     NType Dk = inf;
-    root->FNDFTrav(center, k, L, Dk);
+    kNNSearch(center, k, L, Dk, stats);
     vector<string> paths;
     while (!L.empty()) {
-        paths.push_back(L.top().point.path);
+        paths.push_back(L.top().point->path);
         L.pop();
     }
     return paths;
 }
 
-bool SsNode::test(bool isRoot) const {
+std::vector<Neighbor> SsTree::kNNSearch(const Point& center, size_t k, QueryStats* stats) const{
+    std::vector<Neighbor> result;
+    if (k == 0) {
+        return result;
+    }
+    NeighborHeap L;
+    NType Dk = inf;
+    kNNSearch(center, k, L, Dk, stats);
+    result.resize(L.size());
+    for (size_t i = result.size(); i-- > 0; L.pop()) {
+        result[i] = {L.top().point->path, L.top().distance};
+    }
+    return result;
+}
+
+void SsTree::kNNSearch(const Point& center, size_t k, NeighborHeap& L, NType& Dk, QueryStats* stats) const{
+    QueryClock::time_point start = QueryClock::now();
+    if (root && k > 0) {
+        root->FNDFTrav(center, k, L, Dk, stats);
+    }
+    if (stats) {
+        stats->totalNanos += nanosSince(start);
+    }
+}
+
+QueryStats& QueryStats::operator+=(const QueryStats& other) {
+    innerVisited += other.innerVisited;
+    leavesVisited += other.leavesVisited;
+    pointsScanned += other.pointsScanned;
+    distanceComputations += other.distanceComputations;
+    heapPushes += other.heapPushes;
+    prunedSubtrees += other.prunedSubtrees;
+    routeNanos += other.routeNanos;
+    scanNanos += other.scanNanos;
+    mergeNanos += other.mergeNanos;
+    totalNanos += other.totalNanos;
+    return *this;
+}
+
+std::ostream& operator<<(std::ostream& out, const QueryStats& stats) {
+    return out << "internos=" << stats.innerVisited << " hojas=" << stats.leavesVisited
+               << " puntos=" << stats.pointsScanned << " distancias=" << stats.distanceComputations
+               << " heap=" << stats.heapPushes << " podados=" << stats.prunedSubtrees
+               << " ruta=" << stats.routeNanos / 1000 << "us hojas=" << stats.scanNanos / 1000
+               << "us mezcla=" << stats.mergeNanos / 1000 << "us total=" << stats.totalNanos / 1000 << "us";
+}
+
+void SsTree::forEachPoint(const std::function<void(const Point&)>& visit) const {
+    std::vector<const SsNode*> stack;
+    if (root) {
+        stack.push_back(root);
+    }
+    while (!stack.empty()) {
+        const SsNode* node = stack.back();
+        stack.pop_back();
+        if (node->isLeaf()) {
+            for (const Point& point : dynamic_cast<const SsLeaf*>(node)->points) {
+                visit(point);
+            }
+        } else {
+            const SsInnerNode* inner = dynamic_cast<const SsInnerNode*>(node);
+            stack.insert(stack.end(), inner->children.begin(), inner->children.end());
+        }
+    }
+}
+
+std::vector<NType> SsTree::radiusSumPerLevel() const {
+    std::vector<NType> sums;
+    for (const LevelStats& level : levelStats()) {
+        sums.push_back(level.radiusSum);
+    }
+    return sums;
+}
+
+std::vector<LevelStats> SsTree::levelStats() const {
+    return stats().levels;
+}
+
+// Bytes de una ruta fuera del objeto string (0 si entra en su buffer interno)
+static size_t heapBytes(const std::string& text) {
+    const char* data = text.data();
+    const char* object = reinterpret_cast<const char*>(&text);
+    bool inlined = data >= object && data < object + sizeof(text);
+    return inlined ? 0 : text.capacity() + 1;
+}
+
+TreeStats SsTree::stats() const {
+    TreeStats result;
+    std::vector<const SsNode*> level;
+    if (root) {
+        level.push_back(root);
+    }
+    // El solapamiento entre hermanos se mide al recorrer los padres y se anota en el nivel siguiente
+    LevelStats childOverlap;
+    while (!level.empty()) {
+        LevelStats current;
+        current.siblingPairs = childOverlap.siblingPairs;
+        current.overlappingPairs = childOverlap.overlappingPairs;
+        current.overlapDepthSum = childOverlap.overlapDepthSum;
+        childOverlap = LevelStats();
+        current.minRadius = std::numeric_limits<float>::max();
+        current.minFill = std::numeric_limits<double>::max();
+        std::vector<const SsNode*> next;
+        for (const SsNode* node : level) {
+            size_t count = 0;
+            size_t centroidBytes = node->centroid.dim() * sizeof(NType);
+            if (node->isLeaf()) {
+                const SsLeaf* leaf = dynamic_cast<const SsLeaf*>(node);
+                count = leaf->points.size();
+                ++result.leaves;
+                result.points += count;
+                result.memory.leaves += sizeof(SsLeaf) + centroidBytes + leaf->points.capacity() * sizeof(Point) +
+                                        leaf->paths.capacity() * sizeof(std::string);
+                for (const Point& point : leaf->points) {
+                    result.memory.coordinates += point.dim() * sizeof(NType);
+                    result.memory.paths += heapBytes(point.path);
+                }
+            } else {
+                const SsInnerNode* inner = dynamic_cast<const SsInnerNode*>(node);
+                count = inner->children.size();
+                ++result.innerNodes;
+                result.memory.innerNodes += sizeof(SsInnerNode) + centroidBytes +
+                                            inner->children.capacity() * sizeof(SsNode*);
+                next.insert(next.end(), inner->children.begin(), inner->children.end());
+
+                for (size_t i = 0; i < count; ++i) {
+                    const SsNode* a = inner->children[i];
+                    for (size_t j = i + 1; j < count; ++j) {
+                        const SsNode* b = inner->children[j];
+                        float radii = a->radius.getValue() + b->radius.getValue();
+                        float gap = radii - distance(a->centroid, b->centroid).getValue();
+                        ++childOverlap.siblingPairs;
+                        if (gap > 0 && radii > 0) {
+                            ++childOverlap.overlappingPairs;
+                            childOverlap.overlapDepthSum += gap / radii;
+                        }
+                    }
+                }
+            }
+
+            ++current.nodes;
+            current.entries += count;
+            current.radiusSum += node->radius;
+            current.minRadius = std::min(current.minRadius.getValue(), node->radius.getValue());
+            current.maxRadius = std::max(current.maxRadius.getValue(), node->radius.getValue());
+            double fill = static_cast<double>(count) / std::max<size_t>(node->maxEntries(params), 1);
+            current.fillSum += fill;
+            current.minFill = std::min(current.minFill, fill);
+            current.maxFill = std::max(current.maxFill, fill);
+            ++current.fillHistogram[std::min<size_t>(static_cast<size_t>(fill * 10), 9)];
+        }
+        result.levels.push_back(current);
+        level = std::move(next);
+    }
+
+    result.height = result.levels.size();
+    return result;
+}
+
+std::ostream& operator<<(std::ostream& out, const TreeStats& stats) {
+    const double MiB = 1024.0 * 1024.0;
+    std::ios::fmtflags flags = out.flags();
+    out << std::fixed << std::setprecision(2);
+    out << "altura: " << stats.height << ", puntos: " << stats.points << ", nodos internos: " << stats.innerNodes
+        << ", hojas: " << stats.leaves << "\n";
+    for (size_t i = 0; i < stats.levels.size(); ++i) {
+        const LevelStats& level = stats.levels[i];
+        out << "  nivel " << i << ": " << level.nodes << " nodos, llenado " << level.meanFill() * 100 << "% ("
+            << level.minFill * 100 << "-" << level.maxFill * 100 << "), radio medio " << level.meanRadius() << " ("
+            << level.minRadius.getValue() << "-" << level.maxRadius.getValue() << "), suma de radios "
+            << level.radiusSum.getValue();
+        if (level.siblingPairs > 0) {
+            out << ", hermanos solapados " << level.overlapRatio() * 100 << "% (profundidad media "
+                << level.meanOverlapDepth() << ")";
+        }
+        out << "\n    llenado por decil:";
+        for (size_t count : level.fillHistogram) {
+            out << " " << count;
+        }
+        out << "\n";
+    }
+    out << "memoria: " << stats.memory.total() / MiB << " MiB (nodos internos " << stats.memory.innerNodes / MiB
+        << ", hojas " << stats.memory.leaves / MiB << ", coordenadas " << stats.memory.coordinates / MiB
+        << ", rutas " << stats.memory.paths / MiB << ")\n";
+    out.flags(flags);
+    return out;
+}
+
+static std::string childLocation(const std::string& location, size_t index) {
+    return location.empty() ? std::to_string(index) : location + "/" + std::to_string(index);
+}
+
+void SsNode::validate(const SsTreeParams& params, size_t D, size_t level, size_t leafLevel, const std::string& location,
+                      bool recursive, std::vector<ValidationError>& errors) const {
+    auto report = [&](ValidationError::Kind kind, const std::string& message) {
+        errors.push_back({kind, level, location, message});
+    };
+
     size_t count = 0;
+    if (centroid.dim() != D) {
+        report(ValidationError::Kind::Dimension, "centroide de dimensión " + std::to_string(centroid.dim()));
+    }
     if (this->isLeaf()) {
         const SsLeaf* leaf = dynamic_cast<const SsLeaf*>(this);
         count = leaf->points.size();
-
-        for (const Point& point : leaf->points) {
-            if (distance(this->centroid, point) > this->radius) {
-                std::cout << "Point outside node radius detected." << std::endl;
-                return false;
+        if (level != leafLevel) {
+            report(ValidationError::Kind::LeafDepth, "hoja en el nivel " + std::to_string(level) + " en lugar de " +
+                                                         std::to_string(leafLevel));
+        }
+        for (size_t i = 0; i < leaf->points.size(); ++i) {
+            const Point& point = leaf->points[i];
+            if (point.dim() != D) {
+                report(ValidationError::Kind::Dimension, "punto " + std::to_string(i) + " (" + point.path +
+                                                             ") de dimensión " + std::to_string(point.dim()));
+            } else if (distance(this->centroid, point) > this->radius) {
+                report(ValidationError::Kind::PointOutsideSphere, "punto " + std::to_string(i) + " (" + point.path +
+                                                                      ") fuera del radio");
             }
         }
     } else {
         const SsInnerNode* inner = dynamic_cast<const SsInnerNode*>(this);
         count = inner->children.size();
-
-        for (const SsNode* child : inner->children) {
-            if (distance(this->centroid, child->centroid) > this->radius) {
-                std::cout << "Child centroid outside parent radius detected." << std::endl;
-                return false;
+        if (level >= leafLevel) {
+            report(ValidationError::Kind::LeafDepth, "nodo interno en el nivel de las hojas");
+        }
+        for (size_t i = 0; i < inner->children.size(); ++i) {
+            const SsNode* child = inner->children[i];
+            if (child->parent != this) {
+                report(ValidationError::Kind::ParentLink, "el hijo " + std::to_string(i) + " no apunta a este nodo");
             }
-            if (!child->test(false)) {
-                return false;
+            if (child->centroid.dim() == D &&
+                distance(this->centroid, child->centroid) + child->radius > this->radius) {
+                report(ValidationError::Kind::ChildOutsideSphere, "la esfera del hijo " + std::to_string(i) +
+                                                                      " sale del radio");
+            }
+            if (recursive && level < leafLevel) {
+                child->validate(params, D, level + 1, leafLevel, childLocation(location, i), true, errors);
             }
         }
     }
 
-    if (!isRoot && (count < Settings::m || count > Settings::M)) {
-        std::cout << "Invalid number of children/points detected." << std::endl;
-        return false;
+    bool isRoot = level == 0;
+    if (!isRoot && (count < minEntries(params) || count > maxEntries(params))) {
+        report(ValidationError::Kind::EntryCount, std::to_string(count) + " entradas, se esperaban entre " +
+                                                      std::to_string(minEntries(params)) + " y " +
+                                                      std::to_string(maxEntries(params)));
+    }
+    if (isRoot && parent) {
+        report(ValidationError::Kind::ParentLink, "la raíz tiene padre");
     }
+}
 
-    if (!isRoot && !parent) {
-        std::cout << "Node without parent detected." << std::endl;
-        return false;
+std::vector<ValidationError> SsTree::validate(size_t threads) const {
+    std::vector<ValidationError> errors;
+    if (!root) {
+        return errors;
+    }
+    if (threads == 0) {
+        threads = std::max(1u, std::thread::hardware_concurrency());
     }
 
-    return true;
-}
+    // Profundidad esperada de las hojas: la del primer camino hacia abajo
+    size_t leafLevel = 0;
+    for (const SsNode* node = root; !node->isLeaf(); ++leafLevel) {
+        const SsInnerNode* inner = dynamic_cast<const SsInnerNode*>(node);
+        if (inner->children.empty()) {
+            break;
+        }
+        node = inner->children[0];
+    }
 
-void SsTree::test() const {
-    bool result = root->test(true);
+    // Los niveles de arriba se revisan en este hilo hasta tener suficientes subárboles para repartir
+    struct Subtree {
+        const SsNode* node;
+        size_t level;
+        std::string location;
+    };
+    std::vector<Subtree> frontier{{root, 0, ""}};
+    while (frontier.size() < threads * 8) {
+        std::vector<Subtree> next;
+        bool expanded = false;
+        for (const Subtree& subtree : frontier) {
+            if (subtree.node->isLeaf() || subtree.level >= leafLevel) {
+                next.push_back(subtree);
+                continue;
+            }
+            subtree.node->validate(params, D, subtree.level, leafLevel, subtree.location, false, errors);
+            const SsInnerNode* inner = dynamic_cast<const SsInnerNode*>(subtree.node);
+            for (size_t i = 0; i < inner->children.size(); ++i) {
+                next.push_back({inner->children[i], subtree.level + 1, childLocation(subtree.location, i)});
+            }
+            expanded = true;
+        }
+        frontier = std::move(next);
+        if (!expanded) {
+            break;
+        }
+    }
 
-    if (root->parent) {
-        std::cout << "Root node parent pointer is not null!" << std::endl;
-        result = false;
+    std::atomic<size_t> nextSubtree{0};
+    std::mutex errorsMutex;
+    auto work = [&]() {
+        std::vector<ValidationError> found;
+        for (size_t i = nextSubtree++; i < frontier.size(); i = nextSubtree++) {
+            const Subtree& subtree = frontier[i];
+            subtree.node->validate(params, D, subtree.level, leafLevel, subtree.location, true, found);
+        }
+        std::lock_guard<std::mutex> lock(errorsMutex);
+        errors.insert(errors.end(), std::make_move_iterator(found.begin()), std::make_move_iterator(found.end()));
+    };
+    std::vector<std::thread> workers;
+    for (size_t t = 1; t < std::min(threads, frontier.size()); ++t) {
+        workers.emplace_back(work);
+    }
+    work();
+    for (std::thread& worker : workers) {
+        worker.join();
     }
 
-    if (result) {
+    std::sort(errors.begin(), errors.end(), [](const ValidationError& a, const ValidationError& b) {
+        return a.level != b.level ? a.level < b.level : a.location < b.location;
+    });
+    return errors;
+}
+
+std::ostream& operator<<(std::ostream& out, const ValidationError& error) {
+    return out << "nivel " << error.level << ", nodo " << (error.location.empty() ? "raíz" : error.location) << ": "
+               << error.message;
+}
+
+bool SsTree::test() const {
+    std::vector<ValidationError> errors = validate();
+    if (errors.empty()) {
         std::cout << "SS-Tree is valid!" << std::endl;
-    } else {
-        std::cout << "SS-Tree has issues!" << std::endl;
+        return true;
     }
+    const size_t MAX_SHOWN = 20;
+    for (size_t i = 0; i < std::min(errors.size(), MAX_SHOWN); ++i) {
+        std::cout << "  " << errors[i] << std::endl;
+    }
+    if (errors.size() > MAX_SHOWN) {
+        std::cout << "  ... y " << errors.size() - MAX_SHOWN << " errores más" << std::endl;
+    }
+    std::cout << "SS-Tree has issues! (" << errors.size() << " errores)" << std::endl;
+    return false;
 }
 
 
@@ -417,10 +1095,22 @@ void SsTree::print() const {
 }
 
 
-void SsLeaf::saveToStream(std::ostream &out) const {
+// Cabecera del archivo del árbol: magic y versión del formato, como el registro .delta
+static const char TREE_MAGIC[4] = {'S', 'S', 'T', 'R'};
+static const uint32_t TREE_FORMAT_VERSION = 1;
+static const size_t MAX_PATH_LENGTH = 1 << 20;
+
+// Una lectura corta indica un archivo truncado o de otro formato
+static void checkStream(const std::istream& in) {
+    if (!in) {
+        throw std::runtime_error("Invalid index file: truncated or corrupt");
+    }
+}
+
+void SsLeaf::saveToStream(std::ostream &out, size_t D) const {
     //cout << "saveToStream Leaf" << endl;
     // Guardar centroid
-    centroid.saveToFile(out, Settings::D);
+    centroid.saveToFile(out, D);
 
     // Guardar el radio
     float radius_ = radius.getValue();
@@ -432,7 +1122,7 @@ void SsLeaf::saveToStream(std::ostream &out) const {
 
     // Guardar los puntos
     for (const auto& point : points) {
-        point.saveToFile(out,  Settings::D);
+        point.saveToFile(out,  D);
     }
 
     // Guardar las rutas (paths)
@@ -446,10 +1136,10 @@ void SsLeaf::saveToStream(std::ostream &out) const {
     }
 }
 
-void SsInnerNode::saveToStream(std::ostream &out) const {
+void SsInnerNode::saveToStream(std::ostream &out, size_t D) const {
     //cout<<"saveToStream Inner"<<endl;
     // Guardar centroid
-    centroid.saveToFile(out,  Settings::D);
+    centroid.saveToFile(out,  D);
 
     // Guardar el radio
     float radius_ = radius.getValue();
@@ -465,13 +1155,13 @@ void SsInnerNode::saveToStream(std::ostream &out) const {
 
     // Guardar los hijos
     for (const auto& child : children) {
-        child->saveToStream(out);
+        child->saveToStream(out, D);
     }
 }
 
-void SsInnerNode::loadFromStream(std::istream &in) {
+void SsInnerNode::loadFromStream(std::istream &in, size_t D) {
     // Leer centroid
-    centroid.readFromFile(in,  Settings::D);
+    centroid.readFromFile(in,  D);
 
     // leer el valor del radio
     float radius_ = 0;
@@ -483,21 +1173,26 @@ void SsInnerNode::loadFromStream(std::istream &in) {
     in.read(reinterpret_cast<char*>(&pointsToLeaf), sizeof(pointsToLeaf));
 
     // leer cantidad de hijos
-    size_t numChildren;
+    size_t numChildren = 0;
     in.read(reinterpret_cast<char*>(&numChildren), sizeof(numChildren));
+    checkStream(in);
+    if (numChildren == 0) {
+        throw std::runtime_error("Invalid index file: inner node without children");
+    }
 
-    // leer hijos
+    // leer hijos; cada uno queda enlazado antes de leerse para que un error no lo pierda
     for (size_t i = 0; i < numChildren; ++i) {
         SsNode* child = pointsToLeaf ? static_cast<SsNode*>(new SsLeaf()) : static_cast<SsNode*>(new SsInnerNode());
-        child->loadFromStream(in);
+        child->parent = this;
         children.push_back(child);
+        child->loadFromStream(in, D);
     }
 }
 
-void SsLeaf::loadFromStream(std::istream &in) {
+void SsLeaf::loadFromStream(std::istream &in, size_t D) {
     //cout<<"loadFromStream Leaf"<<endl;
     // Leer centroid
-    centroid.readFromFile(in,  Settings::D);
+    centroid.readFromFile(in,  D);
 
     // Leer radio
     float radius_ = 0;
@@ -505,27 +1200,35 @@ void SsLeaf::loadFromStream(std::istream &in) {
     this->radius = radius_;
 
     // Leer numero de puntos
-    size_t numPoints;
+    size_t numPoints = 0;
     in.read(reinterpret_cast<char*>(&numPoints), sizeof(numPoints));
+    checkStream(in);
 
-    // Leer puntos
-    points.resize(numPoints);
+    // Leer puntos; se agregan de a uno para que una cuenta corrupta falle en la lectura y no al reservar
+    points.clear();
     for (size_t i = 0; i < numPoints; ++i) {
-        points[i].readFromFile(in,  Settings::D);
+        points.emplace_back();
+        points.back().readFromFile(in,  D);
+        checkStream(in);
     }
 
     // Leer rutas (paths)
-    size_t numPaths;
+    size_t numPaths = 0;
     in.read(reinterpret_cast<char*>(&numPaths), sizeof(numPaths));
+    checkStream(in);
+    if (numPaths != numPoints) {
+        throw std::runtime_error("Invalid index file: path count does not match point count");
+    }
     for (size_t i = 0; i < numPaths; ++i) {
-        size_t pathLength;
+        size_t pathLength = 0;
         in.read(reinterpret_cast<char*>(&pathLength), sizeof(pathLength));
-        char* buffer = new char[pathLength + 1];
-        in.read(buffer, (long) pathLength);
-        buffer[pathLength] = '\0';
-        points[i].path = std::string(buffer);
-        //cout << "path: " << points[i].path << endl;
-        delete[] buffer;
+        checkStream(in);
+        if (pathLength > MAX_PATH_LENGTH) {
+            throw std::runtime_error("Invalid index file: path too long");
+        }
+        points[i].path.resize(pathLength);
+        in.read(&points[i].path[0], (long) pathLength);
+        checkStream(in);
     }
 }
 
@@ -535,42 +1238,145 @@ void SsTree::saveToFile(const std::string &filename) const {
     if (!out) {
         throw std::runtime_error("Cannot open file for writing");
     }
+    saveToStream(out);
+    out.close();
+}
+
+void SsTree::saveToStream(std::ostream &out) const {
+    out.write(TREE_MAGIC, sizeof(TREE_MAGIC));
+    out.write(reinterpret_cast<const char*>(&TREE_FORMAT_VERSION), sizeof(TREE_FORMAT_VERSION));
 
     // Guardar las dimensiones de la estructura
     out.write(reinterpret_cast<const char*>(&D), sizeof(D));
 
+    // Guardar las capacidades y la política de construcción del árbol
+    out.write(reinterpret_cast<const char*>(&params.leafMax), sizeof(params.leafMax));
+    out.write(reinterpret_cast<const char*>(&params.leafMin), sizeof(params.leafMin));
+    out.write(reinterpret_cast<const char*>(&params.innerMax), sizeof(params.innerMax));
+    out.write(reinterpret_cast<const char*>(&params.innerMin), sizeof(params.innerMin));
+    out.write(reinterpret_cast<const char*>(&params.split), sizeof(params.split));
+    out.write(reinterpret_cast<const char*>(&params.reinsert), sizeof(params.reinsert));
+    out.write(reinterpret_cast<const char*>(&params.reinsertFraction), sizeof(params.reinsertFraction));
+
+    // Un árbol vacío no tiene raíz que guardar
+    bool hasRoot = root != nullptr;
+    out.write(reinterpret_cast<const char*>(&hasRoot), sizeof(hasRoot));
+    if (!hasRoot) {
+        return;
+    }
+
     // Guardar si el root es hija o nodo interno
     bool isLeaf = root->isLeaf();
     out.write(reinterpret_cast<const char*>(&isLeaf), sizeof(isLeaf));
 
     // Guardar el resto de la estructura
-    root->saveToStream(out);
-    out.close();
+    root->saveToStream(out, D);
 }
 
-void SsTree::loadFromFile(const std::string &filename) {
+// Lee del archivo en bloques grandes y avisa del avance al rellenar cada bloque
+class ProgressStreamBuf : public std::streambuf {
+private:
+    std::streambuf* source;
+    const LoadProgress& progress;
+    size_t totalBytes;
+    size_t bytesRead = 0;
+    std::vector<char> buffer;
+
+protected:
+    int_type underflow() override {
+        std::streamsize count = source->sgetn(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+        if (count <= 0) {
+            return traits_type::eof();
+        }
+        bytesRead += static_cast<size_t>(count);
+        progress(bytesRead, totalBytes);
+        setg(buffer.data(), buffer.data(), buffer.data() + count);
+        return traits_type::to_int_type(buffer[0]);
+    }
+
+public:
+    ProgressStreamBuf(std::streambuf* source, const LoadProgress& progress, size_t totalBytes)
+        : source(source), progress(progress), totalBytes(totalBytes), buffer(4 << 20) {}
+};
+
+void SsTree::loadFromFile(const std::string &filename, const LoadProgress &progress) {
     //cout<<"loadFromFile"<<endl;
-    std::ifstream in(filename, std::ios::binary);
+    std::ifstream in(filename, std::ios::binary | std::ios::ate);
     if (!in) {
         throw std::runtime_error("Cannot open file for reading");
     }
+    size_t totalBytes = static_cast<size_t>(in.tellg());
+    in.seekg(0);
+    if (progress) {
+        ProgressStreamBuf counted(in.rdbuf(), progress, totalBytes);
+        std::istream countedIn(&counted);
+        loadFromStream(countedIn);
+    } else {
+        loadFromStream(in);
+    }
+    in.close();
+}
+
+void SsTree::loadFromStream(std::istream &in) {
     if (root) {
         delete root;
         root = nullptr;
     }
 
+    char magic[4];
+    uint32_t version = 0;
+    if (!in.read(magic, sizeof(magic)) || std::memcmp(magic, TREE_MAGIC, sizeof(magic)) != 0) {
+        throw std::runtime_error("Invalid index file: not an SS-tree index or written by an older version");
+    }
+    in.read(reinterpret_cast<char*>(&version), sizeof(version));
+    checkStream(in);
+    if (version != TREE_FORMAT_VERSION) {
+        throw std::runtime_error("Unsupported index format version " + std::to_string(version));
+    }
+
     // Aquí se asume que el primer valor determina las dimensiones
     in.read(reinterpret_cast<char*>(&D), sizeof(D));
 
+    // Capacidades y política con las que se construyó el árbol
+    SsTreeParams loaded;
+    in.read(reinterpret_cast<char*>(&loaded.leafMax), sizeof(loaded.leafMax));
+    in.read(reinterpret_cast<char*>(&loaded.leafMin), sizeof(loaded.leafMin));
+    in.read(reinterpret_cast<char*>(&loaded.innerMax), sizeof(loaded.innerMax));
+    in.read(reinterpret_cast<char*>(&loaded.innerMin), sizeof(loaded.innerMin));
+    in.read(reinterpret_cast<char*>(&loaded.split), sizeof(loaded.split));
+    in.read(reinterpret_cast<char*>(&loaded.reinsert), sizeof(loaded.reinsert));
+    in.read(reinterpret_cast<char*>(&loaded.reinsertFraction), sizeof(loaded.reinsertFraction));
+    checkStream(in);
+    try {
+        loaded.validate();
+    } catch (std::invalid_argument& e) {
+        throw std::runtime_error(std::string("Invalid index file: ") + e.what());
+    }
+    params = loaded;
+
+    bool hasRoot = false;
+    in.read(reinterpret_cast<char*>(&hasRoot), sizeof(hasRoot));
+    checkStream(in);
+    if (!hasRoot) {
+        return;
+    }
+
     // El segundo valor determina si el root es hoja
-    bool isLeaf;
+    bool isLeaf = false;
     in.read(reinterpret_cast<char*>(&isLeaf), sizeof(isLeaf));
+    checkStream(in);
     if (isLeaf) {
         root = new SsLeaf();
     } else {
         root = new SsInnerNode();
     }
-    root->loadFromStream(in);
-    in.close();
+    // Un archivo a medio leer no deja un árbol parcial
+    try {
+        root->loadFromStream(in, D);
+    } catch (...) {
+        delete root;
+        root = nullptr;
+        throw;
+    }
 }
 
@@ -7,16 +7,22 @@
 #include <queue>
 #include <limits>
 #include <fstream>
+#include <functional>
+#include <string>
+#include <chrono>
+#include <cstdint>
+#include <array>
 
 #include "params.h"
 #include "Point.h"
 
 
+// El punto se referencia desde su hoja: el heap de la consulta no copia coordenadas
 struct Pair {
-    Point point;
+    const Point* point;
     NType distance;
 
-    Pair(const Point& p, NType d) : point(p), distance(d) {}
+    Pair(const Point& p, NType d) : point(&p), distance(d) {}
 };
 
 struct Comparator {
@@ -25,11 +31,131 @@ struct Comparator {
     }
 };
 
+// Candidatos de una consulta kNN: el tope es el más lejano de los k mejores
+using NeighborHeap = std::priority_queue<Pair, std::vector<Pair>, Comparator>;
+
+// Resultado de una consulta con su distancia: permite mezclar resultados de varios árboles
+struct Neighbor {
+    std::string path;
+    NType distance;
+};
+
+// Resumen de un nivel del árbol (nivel 0 = raíz)
+struct LevelStats {
+    size_t nodes = 0;
+    size_t entries = 0;     // hijos en niveles internos, puntos en el nivel de hojas
+    NType radiusSum = 0;
+    NType minRadius = 0;
+    NType maxRadius = 0;
+
+    // Llenado de cada nodo (entradas / capacidad): fillHistogram[i] cuenta los nodos con llenado en
+    // [i/10, (i+1)/10); el último decil incluye los nodos llenos
+    double fillSum = 0;
+    double minFill = 0;
+    double maxFill = 0;
+    std::array<size_t, 10> fillHistogram{};
+
+    // Solapamiento entre hermanos (pares de esferas con el mismo padre). La profundidad de un par es
+    // (r1 + r2 - d) / (r1 + r2): 0 si apenas se tocan, 1 si son concéntricas
+    size_t siblingPairs = 0;
+    size_t overlappingPairs = 0;
+    double overlapDepthSum = 0;
+
+    double meanRadius() const {
+        return nodes > 0 ? radiusSum.getValue() / nodes : 0.0;
+    }
+    double meanFill() const {
+        return nodes > 0 ? fillSum / nodes : 0.0;
+    }
+    double overlapRatio() const {
+        return siblingPairs > 0 ? static_cast<double>(overlappingPairs) / siblingPairs : 0.0;
+    }
+    double meanOverlapDepth() const {
+        return overlappingPairs > 0 ? overlapDepthSum / overlappingPairs : 0.0;
+    }
+};
+
+// Memoria aproximada del árbol por componente, en bytes
+struct MemoryStats {
+    size_t innerNodes = 0;      // nodos internos, sus centroides y vectores de hijos
+    size_t leaves = 0;          // hojas, sus centroides y los vectores de puntos
+    size_t coordinates = 0;     // coordenadas de los puntos
+    size_t paths = 0;           // rutas que no entran en el buffer interno del string
+
+    size_t total() const {
+        return innerNodes + leaves + coordinates + paths;
+    }
+};
+
+// Estructura completa del árbol: sirve para decidir si un índice se degradó lo suficiente (llenado
+// bajo, mucho solapamiento) como para reconstruirlo
+struct TreeStats {
+    size_t height = 0;
+    size_t points = 0;
+    size_t innerNodes = 0;
+    size_t leaves = 0;
+    std::vector<LevelStats> levels;
+    MemoryStats memory;
+};
+
+std::ostream& operator<<(std::ostream& out, const TreeStats& stats);
+
+// Invariante roto encontrado por SsTree::validate
+struct ValidationError {
+    enum class Kind {
+        PointOutsideSphere,     // un punto de la hoja queda fuera de su radio
+        ChildOutsideSphere,     // la esfera de un hijo no está contenida en la del padre
+        EntryCount,             // entradas fuera de [mín, máx] de la capacidad
+        ParentLink,             // puntero al padre que no corresponde
+        Dimension,              // punto o centroide con otra dimensión que el árbol
+        LeafDepth               // hojas a distinta profundidad
+    };
+
+    Kind kind;
+    size_t level;
+    std::string location;       // índices de hijo desde la raíz, p. ej. "3/0/17" ("" es la raíz)
+    std::string message;
+};
+
+std::ostream& operator<<(std::ostream& out, const ValidationError& error);
+
+// Avance de una carga desde archivo: bytes leídos y tamaño total
+using LoadProgress = std::function<void(size_t bytesRead, size_t totalBytes)>;
+
+// Contadores opcionales de una consulta kNN. Se acumulan: pasar el mismo objeto a varias consultas
+// suma todas. Los tiempos de fase suman el trabajo de todos los hilos que participan (en un índice
+// particionado pueden superar a totalNanos, que es el tiempo de pared de la consulta).
+struct QueryStats {
+    size_t innerVisited = 0;
+    size_t leavesVisited = 0;
+    size_t pointsScanned = 0;           // puntos de las hojas visitadas
+    size_t distanceComputations = 0;
+    size_t heapPushes = 0;              // candidatos que entraron al heap de los k mejores
+    size_t prunedSubtrees = 0;          // hijos descartados sin visitar por la cota de la esfera
+
+    uint64_t routeNanos = 0;            // elegir por dónde bajar: ordenar hijos, elegir listas IVF
+    uint64_t scanNanos = 0;             // recorrer hojas
+    uint64_t mergeNanos = 0;            // mezclar resultados de varios árboles
+    uint64_t totalNanos = 0;
+
+    QueryStats& operator+=(const QueryStats& other);
+};
+
+std::ostream& operator<<(std::ostream& out, const QueryStats& stats);
+
+using QueryClock = std::chrono::steady_clock;
+
+inline uint64_t nanosSince(QueryClock::time_point start) {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(QueryClock::now() - start).count();
+}
+
 class SsNode {
 private:
-    NType varianceAlongDirection(const std::vector<Point>& centroids, size_t direction) const;
-    size_t minVarianceSplit(size_t coordinateIndex);
-    
+    NType varianceAlongDirection(const std::vector<const Point*>& centroids, size_t direction) const;
+    size_t minVarianceSplit(size_t coordinateIndex, size_t minEntries);
+    size_t minOverlapSplit(size_t minEntries);
+    size_t kMeansSplit(size_t minEntries);
+
 public:
     virtual ~SsNode() = default;
 
@@ -38,118 +164,186 @@ public:
     SsNode* parent = nullptr;
 
     virtual bool isLeaf() const = 0;
-    virtual std::vector<Point> getEntriesCentroids() const = 0;
+    virtual std::vector<const Point*> getEntriesCentroids() const = 0;
+    virtual std::vector<NType> getEntriesRadii() const = 0;
     virtual void sortEntriesByCoordinate(size_t coordinateIndex) = 0;
-    virtual std::pair<SsNode*, SsNode*> split() = 0;
+    virtual void reorderEntries(const std::vector<size_t>& order) = 0;
+    virtual std::pair<SsNode*, SsNode*> split(const SsTreeParams& params) = 0;
     virtual bool intersectsPoint(const Point& point) const {
         return distance(this->centroid, point) <= this->radius;
     }
 
     virtual void updateBoundingEnvelope() = 0;
     size_t directionOfMaxVariance() const;
-    size_t findSplitIndex();
+    size_t findSplitIndex(const SsTreeParams& params);
 
-    virtual pair<SsNode*,SsNode*> insert(const Point& point) = 0;
+    // Capacidades que corresponden a este tipo de nodo
+    size_t maxEntries(const SsTreeParams& params) const {
+        return isLeaf() ? params.leafMax : params.innerMax;
+    }
+    size_t minEntries(const SsTreeParams& params) const {
+        return isLeaf() ? params.leafMin : params.innerMin;
+    }
 
-    bool test(bool isRoot = false) const;
+    // reinsertQueue recibe las entradas expulsadas por reinserción forzada; nullptr la desactiva
+    virtual pair<SsNode*,SsNode*> insert(Point&& point, const SsTreeParams& params, std::vector<Point>* reinsertQueue) = 0;
+
+    // Revisa los invariantes del nodo y, con recursive, los de todo su subárbol; agrega a errors lo que
+    // encuentre. leafLevel es el nivel en el que deben estar todas las hojas.
+    void validate(const SsTreeParams& params, size_t D, size_t level, size_t leafLevel, const std::string& location,
+                  bool recursive, std::vector<ValidationError>& errors) const;
     void print(size_t indent) const;
 
-    virtual void FNDFTrav(const Point& q, size_t k, std::priority_queue<Pair, std::vector<Pair>, Comparator>& L, NType& Dk) const = 0;
+    virtual void FNDFTrav(const Point& q, size_t k, std::priority_queue<Pair, std::vector<Pair>, Comparator>& L, NType& Dk, QueryStats* stats) const = 0;
 
 
-    virtual void saveToStream(std::ostream &out) const = 0;
-    virtual void loadFromStream(std::istream &in) = 0;
+    virtual void saveToStream(std::ostream &out, size_t D) const = 0;
+    virtual void loadFromStream(std::istream &in, size_t D) = 0;
 };
 
 class SsInnerNode : public SsNode {
 private:
-    std::vector<Point> getEntriesCentroids() const override;
+    std::vector<const Point*> getEntriesCentroids() const override;
+    std::vector<NType> getEntriesRadii() const override;
     void sortEntriesByCoordinate(size_t coordinateIndex) override;
+    void reorderEntries(const std::vector<size_t>& order) override;
 
 public:
     SsInnerNode() = default;
     SsInnerNode(size_t d);
-    std::pair<SsNode*, SsNode*> split() override;
+    ~SsInnerNode() override {
+        for (SsNode* child : children) {
+            delete child;
+        }
+    }
+    std::pair<SsNode*, SsNode*> split(const SsTreeParams& params) override;
     std::vector<SsNode*> children;
 
     SsNode* findClosestChild(const Point& target) const;
     bool isLeaf() const override { return false; }
     void updateBoundingEnvelope() override;
 
-    pair<SsNode*,SsNode*> insert(const Point& point) override;
+    pair<SsNode*,SsNode*> insert(Point&& point, const SsTreeParams& params, std::vector<Point>* reinsertQueue) override;
 
-    void FNDFTrav(const Point& q, size_t k, std::priority_queue<Pair, std::vector<Pair>, Comparator>& L, NType& Dk) const override;
+    void FNDFTrav(const Point& q, size_t k, std::priority_queue<Pair, std::vector<Pair>, Comparator>& L, NType& Dk, QueryStats* stats) const override;
 
-    virtual void saveToStream(std::ostream &out) const override;
-    virtual void loadFromStream(std::istream &in) override;
+    virtual void saveToStream(std::ostream &out, size_t D) const override;
+    virtual void loadFromStream(std::istream &in, size_t D) override;
 };
 
 class SsLeaf : public SsNode {
 private:
 
-    std::vector<Point> getEntriesCentroids() const override;
+    std::vector<const Point*> getEntriesCentroids() const override;
+    std::vector<NType> getEntriesRadii() const override;
     void sortEntriesByCoordinate(size_t coordinateIndex) override;
+    void reorderEntries(const std::vector<size_t>& order) override;
 
 public:
     SsLeaf() = default;
     SsLeaf(size_t d);
-    std::pair<SsNode*, SsNode*> split() override;
+    std::pair<SsNode*, SsNode*> split(const SsTreeParams& params) override;
     std::vector<std::string> paths;
     std::vector<Point> points;
 
     bool isLeaf() const override { return true; }
     void updateBoundingEnvelope() override;
 
-    pair<SsNode*,SsNode*> insert(const Point& point) override;
+    pair<SsNode*,SsNode*> insert(Point&& point, const SsTreeParams& params, std::vector<Point>* reinsertQueue) override;
 
-    void FNDFTrav(const Point& q, size_t k, std::priority_queue<Pair, std::vector<Pair>, Comparator>& L, NType& Dk) const override;
+    void FNDFTrav(const Point& q, size_t k, std::priority_queue<Pair, std::vector<Pair>, Comparator>& L, NType& Dk, QueryStats* stats) const override;
 
-    virtual void saveToStream(std::ostream &out) const override;
-    virtual void loadFromStream(std::istream &in) override;
+    virtual void saveToStream(std::ostream &out, size_t D) const override;
+    virtual void loadFromStream(std::istream &in, size_t D) override;
 };
 
 
 class SsTree {
 private:
     SsNode* root;
+    SsTreeParams params;
     SsNode* search(SsNode* node, const Point& target);
     SsNode* searchParentLeaf(SsNode* node, const Point& target);
+    void insertPoint(Point&& point, std::vector<Point>* reinsertQueue);
+    void adoptDimension(size_t d);
 
 public:
-    SsTree() : root(nullptr) {}
+    SsTree(const SsTreeParams& params = SsTreeParams()) : root(nullptr), params(params) {
+        params.validate();
+    }
     ~SsTree() {
         delete root;
     }
 
-    size_t D;
-
-    NType nivel0() const {
-        return root->radius;
+    // El árbol es dueño de sus nodos: se puede mover pero no copiar
+    SsTree(const SsTree&) = delete;
+    SsTree& operator=(const SsTree&) = delete;
+    SsTree(SsTree&& other) noexcept : root(other.root), params(other.params), D(other.D) {
+        other.root = nullptr;
     }
-
-    NType nivel1() const {
-        NType sum = 0;
-        for (auto child : ((SsInnerNode*)root)->children) {
-            sum += child->radius;
-            cout << child->radius << endl;  
+    SsTree& operator=(SsTree&& other) noexcept {
+        if (this != &other) {
+            delete root;
+            root = other.root;
+            params = other.params;
+            D = other.D;
+            other.root = nullptr;
         }
-        return sum;
+        return *this;
     }
 
+    size_t D = 0;
+
+    // Suma de radios por nivel (nivel 0 = raíz)
+    std::vector<NType> radiusSumPerLevel() const;
+    // Estadísticas por nivel; su tamaño es la altura del árbol
+    std::vector<LevelStats> levelStats() const;
+    // Altura, nodos, llenado, radios y solapamiento por nivel y memoria por componente
+    TreeStats stats() const;
+
     void setD(size_t d) {
         D = d;
     }
+
+    const SsTreeParams& getParams() const {
+        return params;
+    }
+    void setParams(const SsTreeParams& newParams) {
+        if (root) {
+            throw std::runtime_error("No se pueden cambiar las capacidades de un árbol no vacío");
+        }
+        newParams.validate();
+        params = newParams;
+    }
     
     void insert(const Point& point);
-    void insert( Point& point, const std::string& path);
+    void insert(Point&& point);
+    void insert(Point point, const std::string& path);
     void build (const std::vector<Point>& points);
-    std::vector<string> kNNQuery(const Point& center, size_t k) const;
+    void build (std::vector<Point>&& points);
+    // Construcción de abajo hacia arriba sobre un árbol vacío: particiona por la dirección de mayor
+    // varianza y empaqueta hojas y nodos internos casi llenos, sin divisiones
+    void bulkLoad(std::vector<Point>&& points);
+    std::vector<string> kNNQuery(const Point& center, size_t k, QueryStats* stats = nullptr) const;
+    // Los k vecinos más cercanos con sus distancias, del más cercano al más lejano
+    std::vector<Neighbor> kNNSearch(const Point& center, size_t k, QueryStats* stats = nullptr) const;
+    // Continúa una búsqueda con candidatos de otros árboles: L y Dk se comparten, así que lo ya encontrado poda este árbol
+    void kNNSearch(const Point& center, size_t k, NeighborHeap& L, NType& Dk, QueryStats* stats = nullptr) const;
+    void forEachPoint(const std::function<void(const Point&)>& visit) const;
 
     void print() const;
-    void test() const;
+    // Invariantes de todo el árbol revisados en paralelo (threads = 0 usa todos los núcleos); vacío si
+    // el árbol es válido
+    std::vector<ValidationError> validate(size_t threads = 0) const;
+    // Imprime el resultado de validate; devuelve true si el árbol es válido
+    bool test() const;
 
     void saveToFile(const std::string &filename) const;
-    void loadFromFile(const std::string &filename);
+    // progress se llama cada pocos megabytes leídos (desde el hilo que carga)
+    void loadFromFile(const std::string &filename, const LoadProgress &progress = nullptr);
+    // Mismo formato que el archivo, para guardar varios árboles en un solo flujo
+    void saveToStream(std::ostream &out) const;
+    void loadFromStream(std::istream &in);
 };
 
 #endif // !SSTREE_H
\ No newline at end of file
@@ -0,0 +1,351 @@
+#include "SegmentedSsTree.h"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <unistd.h>
+
+static const char LOG_MAGIC[4] = {'S', 'S', 'D', 'L'};
+
+static void writeRecord(std::ostream& out, const Point& point, size_t D) {
+    point.saveToFile(out, D);
+    uint64_t pathLength = point.path.size();
+    out.write(reinterpret_cast<const char*>(&pathLength), sizeof(pathLength));
+    out.write(point.path.data(), static_cast<std::streamsize>(pathLength));
+}
+
+// Devuelve false si el registro está incompleto (escritura interrumpida al final del archivo)
+static bool readRecord(std::istream& in, Point& point, size_t D) {
+    std::vector<float> coordinates(D);
+    uint64_t pathLength = 0;
+    if (!in.read(reinterpret_cast<char*>(coordinates.data()), static_cast<std::streamsize>(D * sizeof(float))) ||
+        !in.read(reinterpret_cast<char*>(&pathLength), sizeof(pathLength))) {
+        return false;
+    }
+    std::string path(pathLength, '\0');
+    if (!in.read(&path[0], static_cast<std::streamsize>(pathLength))) {
+        return false;
+    }
+    point = Point(std::vector<NType>(coordinates.begin(), coordinates.end()));
+    point.path = std::move(path);
+    return true;
+}
+
+SegmentedSsTree::SegmentedSsTree(const std::string& fileName, size_t segmentCapacity, const SsTreeParams& params,
+                                 const LoadProgress& progress, OpenMode mode)
+    : fileName(fileName), logName(fileName + ".delta"), segmentCapacity(std::max<size_t>(segmentCapacity, 1)),
+      mainTree(params), mode(mode) {
+    if (mode == OpenMode::ReadWrite) {
+        lock();
+    }
+    try {
+        // El registro se abre antes de leer el índice: una compactación reemplaza primero el índice y
+        // después el registro, así que el índice leído nunca es anterior al registro abierto
+        std::ifstream logIn(logName, std::ios::binary);
+        if (std::ifstream(fileName, std::ios::binary)) {
+            mainTree.loadFromFile(fileName, progress);
+            mainTree.forEachPoint([this](const Point&) { ++mainSize; });
+            D = mainTree.D;
+        }
+        active = SsTree(mainTree.getParams());
+
+        if (logIn) {
+            replayLog(logIn);
+        }
+        if (mode == OpenMode::ReadOnly) {
+            return;
+        }
+        // El registro se reescribe para descartar un posible registro final incompleto antes de seguir anotando
+        rewriteLog();
+        if (!sealed.empty()) {
+            scheduleCompaction();
+        }
+    } catch (...) {
+        unlock();
+        throw;
+    }
+}
+
+SegmentedSsTree::~SegmentedSsTree() {
+    try {
+        waitForCompaction();
+    } catch (std::exception& e) {
+        std::cerr << "Compactación fallida: " << e.what() << std::endl;
+    }
+    unlock();
+}
+
+// Candado de escritura entre procesos; se libera al cerrar el descriptor
+void SegmentedSsTree::lock() {
+    std::string lockName = fileName + ".lock";
+    lockFd = open(lockName.c_str(), O_RDWR | O_CREAT, 0644);
+    if (lockFd < 0) {
+        throw std::runtime_error("Cannot open lock file: " + lockName);
+    }
+    if (flock(lockFd, LOCK_EX | LOCK_NB) != 0) {
+        bool busy = errno == EWOULDBLOCK;
+        unlock();
+        throw std::runtime_error(busy ? "Index is open for writing by another process: " + fileName
+                                      : "Cannot lock index: " + lockName);
+    }
+}
+
+void SegmentedSsTree::unlock() {
+    if (lockFd >= 0) {
+        close(lockFd);
+        lockFd = -1;
+    }
+}
+
+void SegmentedSsTree::checkWritable() const {
+    if (mode == OpenMode::ReadOnly) {
+        throw std::runtime_error("Index opened read-only: " + fileName);
+    }
+}
+
+void SegmentedSsTree::replayLog(std::istream& in) {
+    char magic[4];
+    uint64_t base = 0;
+    uint64_t dimension = 0;
+    if (!in.read(magic, sizeof(magic)) || std::memcmp(magic, LOG_MAGIC, sizeof(magic)) != 0 ||
+        !in.read(reinterpret_cast<char*>(&base), sizeof(base)) ||
+        !in.read(reinterpret_cast<char*>(&dimension), sizeof(dimension))) {
+        throw std::runtime_error("Invalid delta log: " + logName);
+    }
+    if (base > mainSize) {
+        throw std::runtime_error("Delta log does not match index: " + logName);
+    }
+    if (dimension == 0) {
+        return;
+    }
+    if (D != 0 && D != dimension) {
+        throw std::runtime_error("Delta log dimension does not match index: " + logName);
+    }
+    D = dimension;
+
+    // Los primeros (mainSize - base) registros ya se mezclaron en el índice antes de reescribir el registro
+    size_t skip = mainSize - base;
+    Point point;
+    while (readRecord(in, point, D)) {
+        if (skip > 0) {
+            --skip;
+            continue;
+        }
+        addToActive(std::move(point));
+    }
+}
+
+// Reescribe el registro con los puntos que aún no están en el índice: los sellados primero, en orden
+void SegmentedSsTree::rewriteLog() {
+    std::string tmpName = logName + ".tmp";
+    {
+        std::ofstream out(tmpName, std::ios::binary | std::ios::trunc);
+        if (!out) {
+            throw std::runtime_error("Cannot open file for writing");
+        }
+        uint64_t base = mainSize;
+        uint64_t dimension = D;
+        out.write(LOG_MAGIC, sizeof(LOG_MAGIC));
+        out.write(reinterpret_cast<const char*>(&base), sizeof(base));
+        out.write(reinterpret_cast<const char*>(&dimension), sizeof(dimension));
+        auto write = [&](const Point& point) { writeRecord(out, point, D); };
+        for (const SsTree& segment : sealed) {
+            segment.forEachPoint(write);
+        }
+        active.forEachPoint(write);
+        if (!out) {
+            throw std::runtime_error("Cannot write delta log: " + tmpName);
+        }
+    }
+    log.close();
+    if (std::rename(tmpName.c_str(), logName.c_str()) != 0) {
+        throw std::runtime_error("Cannot replace delta log: " + logName);
+    }
+    log.open(logName, std::ios::binary | std::ios::app);
+    if (!log) {
+        throw std::runtime_error("Cannot open file for writing");
+    }
+}
+
+void SegmentedSsTree::addToActive(Point&& point) {
+    active.insert(std::move(point));
+    if (++activeSize >= segmentCapacity) {
+        sealed.push_back(std::move(active));
+        sealedSize += activeSize;
+        active = SsTree(mainTree.getParams());
+        activeSize = 0;
+    }
+}
+
+// Se llama con el candado exclusivo tomado
+void SegmentedSsTree::scheduleCompaction() {
+    if (compactionRunning) {
+        return;     // la compactación en curso vuelve a revisar los segmentos sellados antes de terminar
+    }
+    compactionRunning = true;
+    compaction = std::async(std::launch::async, [this]() {
+        std::lock_guard<std::mutex> guard(compactionMutex);
+        try {
+            while (true) {
+                {
+                    // Mezclar bloquea las consultas, pero solo por la inserción de los segmentos sellados
+                    std::unique_lock<std::shared_mutex> lock(mutex);
+                    if (sealed.empty()) {
+                        compactionRunning = false;
+                        return;
+                    }
+                    for (const SsTree& segment : sealed) {
+                        segment.forEachPoint([this](const Point& point) { mainTree.insert(point); });
+                    }
+                    mainSize += sealedSize;
+                    sealed.clear();
+                    sealedSize = 0;
+                }
+
+                // Solo esta tarea modifica el árbol principal (y hay una a la vez), así que se guarda sin
+                // candado: consultas y altas siguen durante la escritura
+                std::string tmpName = fileName + ".tmp";
+                mainTree.saveToFile(tmpName);
+
+                std::unique_lock<std::shared_mutex> lock(mutex);
+                if (std::rename(tmpName.c_str(), fileName.c_str()) != 0) {
+                    throw std::runtime_error("Cannot replace index file: " + fileName);
+                }
+                rewriteLog();
+            }
+        } catch (...) {
+            // El error se guarda hasta la próxima alta o waitForCompaction; una compactación nueva reemplaza
+            // el futuro, así que no puede quedar solo ahí
+            std::unique_lock<std::shared_mutex> lock(mutex);
+            compactionError = std::current_exception();
+            compactionRunning = false;
+        }
+    }).share();
+}
+
+// Se llama con el candado tomado
+void SegmentedSsTree::rethrowCompactionError() {
+    if (compactionError) {
+        std::exception_ptr error = compactionError;
+        compactionError = nullptr;
+        std::rethrow_exception(error);
+    }
+}
+
+void SegmentedSsTree::insert(Point point, const std::string& path) {
+    checkWritable();
+    point.path = "../" + path;
+
+    std::unique_lock<std::shared_mutex> lock(mutex);
+    rethrowCompactionError();
+    if (D == 0) {
+        D = point.dim();
+        rewriteLog();   // la cabecera ya conoce la dimensión
+    } else if (point.dim() != D) {
+        throw std::runtime_error("Point dimension does not match index dimension");
+    }
+    writeRecord(log, point, D);
+    log.flush();
+    if (!log) {
+        throw std::runtime_error("Cannot write delta log: " + logName);
+    }
+
+    size_t sealedBefore = sealed.size();
+    addToActive(std::move(point));
+    if (sealed.size() != sealedBefore) {
+        scheduleCompaction();
+    }
+}
+
+std::vector<Neighbor> SegmentedSsTree::kNNSearch(const Point& center, size_t k, QueryStats* stats) const {
+    QueryClock::time_point start = QueryClock::now();
+    uint64_t total = stats ? stats->totalNanos : 0;
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    std::vector<Neighbor> merged = mainTree.kNNSearch(center, k, stats);
+    auto add = [&](const SsTree& segment) {
+        std::vector<Neighbor> partial = segment.kNNSearch(center, k, stats);
+        merged.insert(merged.end(), std::make_move_iterator(partial.begin()), std::make_move_iterator(partial.end()));
+    };
+    for (const SsTree& segment : sealed) {
+        add(segment);
+    }
+    add(active);
+    lock.unlock();
+
+    QueryClock::time_point mergeStart = QueryClock::now();
+    size_t count = std::min(k, merged.size());
+    std::partial_sort(merged.begin(), merged.begin() + count, merged.end(), [](const Neighbor& a, const Neighbor& b) {
+        return a.distance.getValue() < b.distance.getValue();
+    });
+    merged.resize(count);
+    if (stats) {
+        stats->mergeNanos += nanosSince(mergeStart);
+        stats->totalNanos = total + nanosSince(start);
+    }
+    return merged;
+}
+
+std::vector<std::string> SegmentedSsTree::kNNQuery(const Point& center, size_t k, QueryStats* stats) const {
+    std::vector<std::string> paths;
+    for (Neighbor& neighbor : kNNSearch(center, k, stats)) {
+        paths.push_back(std::move(neighbor.path));
+    }
+    return paths;
+}
+
+void SegmentedSsTree::forEachPoint(const std::function<void(const Point&)>& visit) const {
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    mainTree.forEachPoint(visit);
+    for (const SsTree& segment : sealed) {
+        segment.forEachPoint(visit);
+    }
+    active.forEachPoint(visit);
+}
+
+void SegmentedSsTree::compact() {
+    checkWritable();
+    {
+        std::unique_lock<std::shared_mutex> lock(mutex);
+        if (activeSize > 0) {
+            sealed.push_back(std::move(active));
+            sealedSize += activeSize;
+            active = SsTree(mainTree.getParams());
+            activeSize = 0;
+        }
+        if (!sealed.empty()) {
+            scheduleCompaction();
+        }
+    }
+    waitForCompaction();
+}
+
+void SegmentedSsTree::waitForCompaction() {
+    std::shared_future<void> pending;
+    {
+        std::shared_lock<std::shared_mutex> lock(mutex);
+        pending = compaction;
+    }
+    if (pending.valid()) {
+        pending.wait();
+    }
+    std::unique_lock<std::shared_mutex> lock(mutex);
+    rethrowCompactionError();
+}
+
+size_t SegmentedSsTree::size() const {
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    return mainSize + sealedSize + activeSize;
+}
+
+size_t SegmentedSsTree::pendingSize() const {
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    return sealedSize + activeSize;
+}
+
+size_t SegmentedSsTree::dim() const {
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    return D;
+}
@@ -0,0 +1,93 @@
+#ifndef SEGMENTED_SSTREE_H
+#define SEGMENTED_SSTREE_H
+
+#include <exception>
+#include <fstream>
+#include <future>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <vector>
+
+#include "SStree.h"
+
+// Índice actualizable sin reconstruirlo: el árbol principal (el archivo del índice) más segmentos delta
+// con las altas recientes. Cada alta se anota en <archivo>.delta y se inserta en el segmento activo; al
+// llenarse, el segmento se sella y una compactación en segundo plano lo mezcla con el árbol principal y
+// reescribe ambos archivos. Las consultas recorren el principal y todos los segmentos y mezclan los resultados.
+//
+// <archivo>.delta: cabecera (magic, puntos del principal al escribirla, dimensión) y registros
+// (coordenadas float, largo y bytes de la ruta). Los registros ya mezclados están siempre al inicio, así
+// que si el proceso se interrumpe entre reescribir el índice y el registro, al abrir se saltan.
+//
+// Un solo proceso puede abrirlo para escribir: toma un flock exclusivo sobre <archivo>.lock mientras
+// viva el objeto. En modo ReadOnly no toma el candado ni escribe nada: el registro se reaplica solo en
+// memoria y los segmentos llenos se consultan sin compactar, así que sirve con permisos de lectura y
+// mientras otro proceso agrega puntos.
+class SegmentedSsTree {
+public:
+    enum class OpenMode { ReadWrite, ReadOnly };
+
+private:
+    std::string fileName;
+    std::string logName;
+    size_t segmentCapacity;
+
+    SsTree mainTree;
+    size_t mainSize = 0;
+    std::vector<SsTree> sealed;     // segmentos llenos a la espera de compactación, en orden de llegada
+    size_t sealedSize = 0;
+    SsTree active;
+    size_t activeSize = 0;
+    size_t D = 0;
+    OpenMode mode;
+    int lockFd = -1;
+
+    std::ofstream log;
+    mutable std::shared_mutex mutex;    // compartido para consultas, exclusivo para modificar árboles o el registro
+    std::mutex compactionMutex;         // una sola compactación a la vez
+    std::shared_future<void> compaction;
+    bool compactionRunning = false;
+    std::exception_ptr compactionError;     // fallo de una compactación aún no informado
+
+    void lock();
+    void unlock();
+    void checkWritable() const;
+    void addToActive(Point&& point);
+    void replayLog(std::istream& in);
+    void rewriteLog();
+    void scheduleCompaction();
+    void rethrowCompactionError();
+
+public:
+    // Abre el índice en fileName (si no existe, empieza vacío con params) y reaplica su registro delta
+    // progress informa el avance de la lectura del árbol principal
+    explicit SegmentedSsTree(const std::string& fileName, size_t segmentCapacity = 4096,
+                             const SsTreeParams& params = SsTreeParams(), const LoadProgress& progress = nullptr,
+                             OpenMode mode = OpenMode::ReadWrite);
+    ~SegmentedSsTree();
+
+    SegmentedSsTree(const SegmentedSsTree&) = delete;
+    SegmentedSsTree& operator=(const SegmentedSsTree&) = delete;
+
+    // Anota la alta en el registro y la deja visible para las consultas de inmediato (no en ReadOnly)
+    void insert(Point point, const std::string& path);
+
+    std::vector<Neighbor> kNNSearch(const Point& center, size_t k, QueryStats* stats = nullptr) const;
+    // Rutas de los k vecinos más cercanos, del más cercano al más lejano
+    std::vector<std::string> kNNQuery(const Point& center, size_t k, QueryStats* stats = nullptr) const;
+
+    // Recorre los puntos del árbol principal y de los segmentos, incluidos los aún no compactados
+    void forEachPoint(const std::function<void(const Point&)>& visit) const;
+
+    // Sella el segmento activo y mezcla todo en el árbol principal antes de volver
+    void compact();
+    void waitForCompaction();
+
+    size_t size() const;
+    // Puntos que todavía no forman parte del árbol principal
+    size_t pendingSize() const;
+    size_t dim() const;
+};
+
+#endif // SEGMENTED_SSTREE_H
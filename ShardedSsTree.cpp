@@ -0,0 +1,205 @@
+#include "ShardedSsTree.h"
+
+#include <exception>
+#include <functional>
+#include <future>
+#include <stdexcept>
+
+ShardedSsTree::ShardedSsTree(size_t shardCount, ShardingPolicy policy, const SsTreeParams& params)
+    : shardSizes(std::max<size_t>(shardCount, 1), 0), policy(policy), params(params) {
+    for (size_t i = 0; i < shardSizes.size(); ++i) {
+        shards.emplace_back(params);
+    }
+    startPool();
+}
+
+// El hilo que consulta resuelve un shard; el pool, a lo sumo uno por núcleo, el resto
+void ShardedSsTree::startPool() {
+    pool.reset();
+    size_t others = shards.empty() ? 0 : shards.size() - 1;
+    size_t threads = std::min<size_t>(others, std::max(1u, std::thread::hardware_concurrency()));
+    if (threads > 0) {
+        pool = std::make_unique<ThreadPool>(threads);
+    }
+}
+
+size_t ShardedSsTree::route(const Point& point) const {
+    if (policy == ShardingPolicy::Cluster) {
+        return nearestCentroid(centroids, point);
+    }
+    return std::hash<std::string>()(point.path) % shards.size();
+}
+
+void ShardedSsTree::build(std::vector<Point>&& points) {
+    if (points.empty()) {
+        return;
+    }
+    if (D == 0) {
+        D = points[0].dim();
+    }
+    if (policy == ShardingPolicy::Cluster && centroids.empty()) {
+        centroids = trainKMeans(points, shards.size());
+    }
+
+    std::vector<std::vector<Point>> parts(shards.size());
+    for (size_t i = 0; i < points.size(); ++i) {
+        // Sin ruta no hay hash: se reparte en orden
+        size_t target = policy == ShardingPolicy::Hash && points[i].path.empty() ? i % shards.size() : route(points[i]);
+        parts[target].push_back(std::move(points[i]));
+    }
+    points.clear();
+
+    // Cada shard se construye en su propio hilo: los árboles no comparten nodos
+    std::vector<std::future<void>> tasks;
+    for (size_t s = 0; s < shards.size(); ++s) {
+        shardSizes[s] += parts[s].size();
+        tasks.push_back(std::async(std::launch::async, [this, s, &parts]() {
+            shards[s].build(std::move(parts[s]));
+        }));
+    }
+    for (std::future<void>& task : tasks) {
+        task.get();
+    }
+}
+
+void ShardedSsTree::insert(Point point, const std::string& path) {
+    if (D == 0) {
+        D = point.dim();
+    }
+    if (policy == ShardingPolicy::Cluster && centroids.empty()) {
+        throw std::runtime_error("Cluster sharding needs centroids: call build first");
+    }
+    point.path = "../" + path;
+    size_t target = route(point);
+    shards[target].insert(std::move(point));
+    ++shardSizes[target];
+}
+
+std::vector<Neighbor> ShardedSsTree::kNNSearch(const Point& center, size_t k, QueryStats* stats) const {
+    QueryClock::time_point start = QueryClock::now();
+    // El hilo que consulta resuelve el primer shard mientras el pool corre el resto
+    std::vector<QueryStats> shardStats(shards.size());
+    std::vector<std::future<std::vector<Neighbor>>> tasks;
+    for (size_t s = 1; s < shards.size(); ++s) {
+        tasks.push_back(pool->submit([this, s, &center, k, &shardStats]() {
+            return shards[s].kNNSearch(center, k, &shardStats[s]);
+        }));
+    }
+    std::vector<Neighbor> merged;
+    std::exception_ptr error;
+    try {
+        merged = shards[0].kNNSearch(center, k, &shardStats[0]);
+    } catch (...) {
+        error = std::current_exception();
+    }
+    // Los futures del pool no esperan al destruirse y las tareas usan center y shardStats:
+    // se esperan todas antes de salir, aunque alguna falle
+    for (std::future<std::vector<Neighbor>>& task : tasks) {
+        task.wait();
+    }
+    if (error) {
+        std::rethrow_exception(error);
+    }
+    for (std::future<std::vector<Neighbor>>& task : tasks) {
+        std::vector<Neighbor> partial = task.get();
+        merged.insert(merged.end(), std::make_move_iterator(partial.begin()), std::make_move_iterator(partial.end()));
+    }
+
+    QueryClock::time_point mergeStart = QueryClock::now();
+    size_t count = std::min(k, merged.size());
+    std::partial_sort(merged.begin(), merged.begin() + count, merged.end(), [](const Neighbor& a, const Neighbor& b) {
+        return a.distance.getValue() < b.distance.getValue();
+    });
+    merged.resize(count);
+
+    if (stats) {
+        uint64_t total = stats->totalNanos;
+        for (const QueryStats& s : shardStats) {
+            *stats += s;
+        }
+        stats->mergeNanos += nanosSince(mergeStart);
+        // Los shards corren en paralelo: el total es el tiempo de pared, no la suma de los shards
+        stats->totalNanos = total + nanosSince(start);
+    }
+    return merged;
+}
+
+std::vector<std::string> ShardedSsTree::kNNQuery(const Point& center, size_t k, QueryStats* stats) const {
+    std::vector<std::string> paths;
+    for (Neighbor& neighbor : kNNSearch(center, k, stats)) {
+        paths.push_back(std::move(neighbor.path));
+    }
+    return paths;
+}
+
+size_t ShardedSsTree::size() const {
+    size_t total = 0;
+    for (size_t count : shardSizes) {
+        total += count;
+    }
+    return total;
+}
+
+void ShardedSsTree::saveToFile(const std::string& fileName) const {
+    std::ofstream out(fileName, std::ios::binary);
+    if (!out) {
+        throw std::runtime_error("Cannot open file for writing");
+    }
+    size_t shardCount = shards.size();
+    size_t centroidCount = centroids.size();
+    out.write(reinterpret_cast<const char*>(&shardCount), sizeof(shardCount));
+    out.write(reinterpret_cast<const char*>(&policy), sizeof(policy));
+    out.write(reinterpret_cast<const char*>(&D), sizeof(D));
+    out.write(reinterpret_cast<const char*>(&centroidCount), sizeof(centroidCount));
+    for (const Point& centroid : centroids) {
+        centroid.saveToFile(out, D);
+    }
+    // Un shard vacío no tiene raíz que guardar: su tamaño 0 basta para recrearlo
+    for (size_t s = 0; s < shardCount; ++s) {
+        out.write(reinterpret_cast<const char*>(&shardSizes[s]), sizeof(shardSizes[s]));
+        if (shardSizes[s] > 0) {
+            shards[s].saveToFile(fileName + "." + std::to_string(s));
+        }
+    }
+}
+
+void ShardedSsTree::loadFromFile(const std::string& fileName) {
+    std::ifstream in(fileName, std::ios::binary);
+    if (!in) {
+        throw std::runtime_error("Cannot open file for reading");
+    }
+    size_t shardCount = 0;
+    size_t centroidCount = 0;
+    in.read(reinterpret_cast<char*>(&shardCount), sizeof(shardCount));
+    in.read(reinterpret_cast<char*>(&policy), sizeof(policy));
+    in.read(reinterpret_cast<char*>(&D), sizeof(D));
+    in.read(reinterpret_cast<char*>(&centroidCount), sizeof(centroidCount));
+    centroids.assign(centroidCount, Point(D));
+    for (Point& centroid : centroids) {
+        centroid.readFromFile(in, D);
+    }
+
+    shards.clear();
+    shardSizes.assign(shardCount, 0);
+    for (size_t s = 0; s < shardCount; ++s) {
+        in.read(reinterpret_cast<char*>(&shardSizes[s]), sizeof(shardSizes[s]));
+        shards.emplace_back(params);
+    }
+    if (!in) {
+        throw std::runtime_error("Invalid sharded index: " + fileName);
+    }
+    startPool();
+
+    // Los shards se leen en paralelo, cada uno desde su archivo
+    std::vector<std::future<void>> tasks;
+    for (size_t s = 0; s < shardCount; ++s) {
+        if (shardSizes[s] > 0) {
+            tasks.push_back(std::async(std::launch::async, [this, s, &fileName]() {
+                shards[s].loadFromFile(fileName + "." + std::to_string(s));
+            }));
+        }
+    }
+    for (std::future<void>& task : tasks) {
+        task.get();
+    }
+}
@@ -0,0 +1,61 @@
+#ifndef SHARDED_SSTREE_H
+#define SHARDED_SSTREE_H
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "SStree.h"
+#include "KMeans.h"
+#include "ThreadPool.h"
+
+enum class ShardingPolicy {
+    Hash,       // por hash de la ruta: shards de tamaño parecido, todas se consultan
+    Cluster     // por el centroide de k-means más cercano: cada shard cubre una región compacta
+};
+
+// Reparte los puntos entre shards SsTree independientes. La construcción y las consultas kNN corren una
+// tarea por shard y las respuestas parciales se mezclan; cada shard sigue siendo un SsTree completo que se
+// guarda en su propio archivo. No admite inserciones concurrentes con otras operaciones.
+//
+// Las consultas reparten los shards en un pool propio de hilos persistentes: crear hilos por consulta
+// cuesta más que recorrer un shard chico, y con muchos hilos consultando multiplicaría los hilos vivos.
+class ShardedSsTree {
+private:
+    std::vector<SsTree> shards;
+    std::vector<size_t> shardSizes;
+    std::vector<Point> centroids;       // solo con ShardingPolicy::Cluster
+    ShardingPolicy policy;
+    SsTreeParams params;
+    size_t D = 0;
+    std::unique_ptr<ThreadPool> pool;   // nullptr con un solo shard
+
+    size_t route(const Point& point) const;
+    void startPool();
+
+public:
+    explicit ShardedSsTree(size_t shardCount, ShardingPolicy policy = ShardingPolicy::Hash,
+                           const SsTreeParams& params = SsTreeParams());
+
+    // Con ShardingPolicy::Cluster entrena los centroides sobre points si aún no existen
+    void build(std::vector<Point>&& points);
+    void insert(Point point, const std::string& path);
+
+    std::vector<Neighbor> kNNSearch(const Point& center, size_t k, QueryStats* stats = nullptr) const;
+    // Rutas de los k vecinos más cercanos, del más cercano al más lejano
+    std::vector<std::string> kNNQuery(const Point& center, size_t k, QueryStats* stats = nullptr) const;
+
+    size_t shardCount() const {
+        return shards.size();
+    }
+    const SsTree& shard(size_t index) const {
+        return shards[index];
+    }
+    size_t size() const;
+
+    // fileName guarda la política, la dimensión y los centroides; cada shard va en <fileName>.<i>
+    void saveToFile(const std::string& fileName) const;
+    void loadFromFile(const std::string& fileName);
+};
+
+#endif // SHARDED_SSTREE_H
@@ -0,0 +1,63 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <functional>
+#include <future>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include "BoundedQueue.h"
+
+// Conjunto fijo de hilos que ejecuta tareas en orden de llegada. submit devuelve un std::future con el
+// resultado (o la excepción) de la tarea; a diferencia de std::async, descartar ese future no bloquea.
+// El destructor termina las tareas ya encoladas antes de unir los hilos.
+class ThreadPool {
+private:
+    BoundedQueue<std::function<void()>> tasks;
+    std::vector<std::thread> workers;
+
+public:
+    explicit ThreadPool(size_t threads, size_t queueCapacity = 1024) : tasks(queueCapacity) {
+        if (threads == 0) {
+            threads = 1;
+        }
+        for (size_t i = 0; i < threads; ++i) {
+            workers.emplace_back([this] {
+                while (std::optional<std::function<void()>> task = tasks.pop()) {
+                    (*task)();
+                }
+            });
+        }
+    }
+
+    ~ThreadPool() {
+        tasks.close();
+        for (std::thread& worker : workers) {
+            worker.join();
+        }
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    template <typename F>
+    std::future<std::invoke_result_t<F>> submit(F task) {
+        using Result = std::invoke_result_t<F>;
+        // std::function exige tareas copiables: el packaged_task se comparte
+        auto packaged = std::make_shared<std::packaged_task<Result()>>(std::move(task));
+        std::future<Result> result = packaged->get_future();
+        if (!tasks.push([packaged] { (*packaged)(); })) {
+            throw std::runtime_error("ThreadPool is shutting down");
+        }
+        return result;
+    }
+
+    size_t size() const {
+        return workers.size();
+    }
+};
+
+#endif // THREAD_POOL_H
@@ -0,0 +1,151 @@
+#include "ThumbnailStore.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static const char THUMB_MAGIC[4] = {'S', 'S', 'T', 'H'};
+static const uint32_t THUMB_VERSION = 1;
+
+ThumbnailStore::ThumbnailStore(const std::string& fileName) {
+    int fd = open(fileName.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error("Cannot open thumbnail store: " + fileName);
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0) {
+        close(fd);
+        throw std::runtime_error("Cannot stat thumbnail store: " + fileName);
+    }
+    length = static_cast<size_t>(info.st_size);
+    if (length < sizeof(Header)) {
+        close(fd);
+        throw std::runtime_error("Invalid thumbnail store: " + fileName);
+    }
+    void* mapped = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapped == MAP_FAILED) {
+        throw std::runtime_error("Cannot map thumbnail store: " + fileName);
+    }
+    data = static_cast<const unsigned char*>(mapped);
+    // El acceso es aleatorio: leer por adelantado solo traería miniaturas que no se piden
+    madvise(mapped, length, MADV_RANDOM);
+
+    Header header;
+    std::memcpy(&header, data, sizeof(header));
+    size_t thumbBytes = header.side * header.side * 4;
+    bool valid = std::memcmp(header.magic, THUMB_MAGIC, sizeof(THUMB_MAGIC)) == 0 && header.version == THUMB_VERSION &&
+                 header.indexOffset == sizeof(Header) + header.count * thumbBytes &&
+                 header.indexOffset + header.count * sizeof(IndexEntry) == length;
+    if (!valid) {
+        munmap(const_cast<unsigned char*>(data), length);
+        throw std::runtime_error("Invalid thumbnail store: " + fileName);
+    }
+    thumbSide = header.side;
+    count = header.count;
+    index = reinterpret_cast<const IndexEntry*>(data + header.indexOffset);
+}
+
+ThumbnailStore::~ThumbnailStore() {
+    munmap(const_cast<unsigned char*>(data), length);
+}
+
+// FNV-1a de 64 bits
+uint64_t ThumbnailStore::pathKey(const std::string& path) {
+    uint64_t hash = 1469598103934665603ULL;
+    for (unsigned char c : path) {
+        hash ^= c;
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+const unsigned char* ThumbnailStore::find(const std::string& path) const {
+    uint64_t key = pathKey(path);
+    const IndexEntry* end = index + count;
+    const IndexEntry* entry = std::lower_bound(index, end, key, [](const IndexEntry& e, uint64_t k) {
+        return e.key < k;
+    });
+    if (entry == end || entry->key != key) {
+        return nullptr;
+    }
+    return data + sizeof(Header) + entry->slot * thumbSide * thumbSide * 4;
+}
+
+std::vector<unsigned char> ThumbnailStore::downscale(const unsigned char* rgba, size_t width, size_t height,
+                                                     size_t side) {
+    std::vector<unsigned char> thumb(side * side * 4);
+    if (width == 0 || height == 0) {
+        return thumb;
+    }
+    for (size_t y = 0; y < side; ++y) {
+        size_t y0 = y * height / side;
+        size_t y1 = std::max(y0 + 1, (y + 1) * height / side);
+        for (size_t x = 0; x < side; ++x) {
+            size_t x0 = x * width / side;
+            size_t x1 = std::max(x0 + 1, (x + 1) * width / side);
+            uint32_t sum[4] = {0, 0, 0, 0};
+            for (size_t sy = y0; sy < y1; ++sy) {
+                const unsigned char* row = rgba + (sy * width + x0) * 4;
+                for (size_t sx = x0; sx < x1; ++sx, row += 4) {
+                    sum[0] += row[0];
+                    sum[1] += row[1];
+                    sum[2] += row[2];
+                    sum[3] += row[3];
+                }
+            }
+            uint32_t area = static_cast<uint32_t>((y1 - y0) * (x1 - x0));
+            unsigned char* out = thumb.data() + (y * side + x) * 4;
+            for (int c = 0; c < 4; ++c) {
+                out[c] = static_cast<unsigned char>((sum[c] + area / 2) / area);
+            }
+        }
+    }
+    return thumb;
+}
+
+ThumbnailWriter::ThumbnailWriter(const std::string& fileName, size_t side)
+    : fileName(fileName), out(fileName, std::ios::binary | std::ios::trunc), side(side) {
+    if (!out) {
+        throw std::runtime_error("Cannot create thumbnail store: " + fileName);
+    }
+    // La cabecera se completa en finish(), cuando se conoce la cantidad
+    ThumbnailStore::Header header{};
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+}
+
+void ThumbnailWriter::add(const std::string& path, const std::vector<unsigned char>& pixels) {
+    if (pixels.size() != side * side * 4) {
+        throw std::runtime_error("Thumbnail of " + path + " has the wrong size");
+    }
+    uint64_t key = ThumbnailStore::pathKey(path);
+    if (!written.insert(key).second) {
+        return;     // con rutas repetidas se queda la primera miniatura
+    }
+    entries.push_back({key, entries.size()});
+    out.write(reinterpret_cast<const char*>(pixels.data()), pixels.size());
+}
+
+void ThumbnailWriter::finish() {
+    std::sort(entries.begin(), entries.end(), [](const auto& a, const auto& b) {
+        return a.key < b.key;
+    });
+
+    ThumbnailStore::Header header;
+    std::memcpy(header.magic, THUMB_MAGIC, sizeof(THUMB_MAGIC));
+    header.version = THUMB_VERSION;
+    header.side = side;
+    header.count = entries.size();
+    header.indexOffset = static_cast<uint64_t>(out.tellp());
+    out.write(reinterpret_cast<const char*>(entries.data()), entries.size() * sizeof(entries[0]));
+    out.seekp(0);
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.close();
+    if (!out) {
+        throw std::runtime_error("Error writing thumbnail store: " + fileName);
+    }
+}
@@ -0,0 +1,79 @@
+#ifndef THUMBNAIL_STORE_H
+#define THUMBNAIL_STORE_H
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+// Miniaturas RGBA de side x side pixeles en un solo archivo mapeado en memoria, indexadas por el hash de
+// la ruta de la imagen (la misma ruta que guarda cada punto del índice). Una miniatura se entrega como
+// puntero al mapeo: mostrarla es copiar side*side*4 bytes, sin decodificar JPEG.
+//
+// Formato: cabecera (magia "SSTH", versión, side, count, offset del índice), pixeles de cada miniatura
+// uno tras otro y al final el índice {hash de ruta, número de miniatura} ordenado por hash.
+class ThumbnailStore {
+private:
+    struct Header {
+        char magic[4];
+        uint32_t version;
+        uint64_t side;
+        uint64_t count;
+        uint64_t indexOffset;
+    };
+    struct IndexEntry {
+        uint64_t key;
+        uint64_t slot;
+    };
+
+    const unsigned char* data = nullptr;
+    size_t length = 0;
+    size_t thumbSide = 0;
+    size_t count = 0;
+    const IndexEntry* index = nullptr;
+
+    friend class ThumbnailWriter;
+
+public:
+    // Lanza std::runtime_error si el archivo no existe o no es un almacén de miniaturas
+    explicit ThumbnailStore(const std::string& fileName);
+    ~ThumbnailStore();
+
+    ThumbnailStore(const ThumbnailStore&) = delete;
+    ThumbnailStore& operator=(const ThumbnailStore&) = delete;
+
+    // Pixeles RGBA de la miniatura de path, o nullptr si no está
+    const unsigned char* find(const std::string& path) const;
+
+    size_t side() const {
+        return thumbSide;
+    }
+    size_t size() const {
+        return count;
+    }
+
+    static uint64_t pathKey(const std::string& path);
+    // Reduce una imagen RGBA a side x side promediando el área que cubre cada pixel de destino
+    static std::vector<unsigned char> downscale(const unsigned char* rgba, size_t width, size_t height, size_t side);
+};
+
+// Escribe un almacén de miniaturas de forma secuencial: los pixeles van al archivo a medida que llegan
+// y el índice se escribe al final en finish().
+class ThumbnailWriter {
+private:
+    std::string fileName;
+    std::ofstream out;
+    size_t side;
+    std::vector<ThumbnailStore::IndexEntry> entries;
+    std::unordered_set<uint64_t> written;
+
+public:
+    ThumbnailWriter(const std::string& fileName, size_t side);
+
+    // pixels debe tener side*side*4 bytes; una ruta ya agregada se ignora
+    void add(const std::string& path, const std::vector<unsigned char>& pixels);
+    void finish();
+};
+
+#endif // THUMBNAIL_STORE_H
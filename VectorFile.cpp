@@ -0,0 +1,232 @@
+#include "VectorFile.h"
+
+#include <cstring>
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static bool endsWith(const std::string& text, const std::string& suffix) {
+    return text.size() >= suffix.size() && text.compare(text.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+VectorFile::VectorFile(const std::string& fileName) {
+    int fd = open(fileName.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error("Cannot open vector file: " + fileName);
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0) {
+        close(fd);
+        throw std::runtime_error("Cannot stat vector file: " + fileName);
+    }
+    length = static_cast<size_t>(info.st_size);
+    if (length > 0) {
+        void* mapped = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapped == MAP_FAILED) {
+            close(fd);
+            throw std::runtime_error("Cannot map vector file: " + fileName);
+        }
+        data = static_cast<const unsigned char*>(mapped);
+        // Las filas se recorren en orden: el kernel puede leer por adelantado
+        madvise(mapped, length, MADV_SEQUENTIAL);
+    }
+    close(fd);
+
+    try {
+        if (endsWith(fileName, ".fvecs")) {
+            format = Format::FVecs;
+            element = Element::Float32;
+            parseVecs(sizeof(float));
+        } else if (endsWith(fileName, ".bvecs")) {
+            format = Format::BVecs;
+            element = Element::UInt8;
+            parseVecs(sizeof(unsigned char));
+        } else if (endsWith(fileName, ".npy")) {
+            format = Format::Npy;
+            parseNpy();
+        } else {
+            throw std::runtime_error("Unknown vector file format: " + fileName);
+        }
+    } catch (...) {
+        if (data) {
+            munmap(const_cast<unsigned char*>(data), length);
+        }
+        throw;
+    }
+}
+
+VectorFile::~VectorFile() {
+    if (data) {
+        munmap(const_cast<unsigned char*>(data), length);
+    }
+}
+
+// Cada fila es un int32 con la dimensión seguido de las coordenadas
+void VectorFile::parseVecs(size_t elementSize) {
+    if (length == 0) {
+        return;
+    }
+    int32_t d = 0;
+    std::memcpy(&d, data, sizeof(d));
+    if (d <= 0) {
+        throw std::runtime_error("Invalid dimension in vector file");
+    }
+    dimension = static_cast<size_t>(d);
+    rowPrefix = sizeof(int32_t);
+    rowStride = rowPrefix + dimension * elementSize;
+    if (length % rowStride != 0) {
+        throw std::runtime_error("Vector file size is not a multiple of its row size");
+    }
+    count = length / rowStride;
+}
+
+// Cabecera .npy: magic, versión, longitud y un diccionario de Python con descr, fortran_order y shape
+void VectorFile::parseNpy() {
+    const char MAGIC[] = "\x93NUMPY";
+    if (length < 10 || std::memcmp(data, MAGIC, 6) != 0) {
+        throw std::runtime_error("Invalid .npy file");
+    }
+    unsigned char major = data[6];
+    size_t headerLength = 0;
+    size_t prefix = 0;
+    if (major == 1) {
+        headerLength = data[8] | (data[9] << 8);
+        prefix = 10;
+    } else {
+        if (length < 12) {
+            throw std::runtime_error("Invalid .npy file");
+        }
+        headerLength = data[8] | (data[9] << 8) | (data[10] << 16) | (static_cast<size_t>(data[11]) << 24);
+        prefix = 12;
+    }
+    headerBytes = prefix + headerLength;
+    if (headerBytes > length) {
+        throw std::runtime_error("Invalid .npy header");
+    }
+    std::string header(reinterpret_cast<const char*>(data) + prefix, headerLength);
+
+    if (header.find("'fortran_order': False") == std::string::npos) {
+        throw std::runtime_error(".npy arrays must be stored in C order");
+    }
+    size_t elementSize = 0;
+    if (header.find("'<f4'") != std::string::npos) {
+        element = Element::Float32;
+        elementSize = 4;
+    } else if (header.find("'<f8'") != std::string::npos) {
+        element = Element::Float64;
+        elementSize = 8;
+    } else if (header.find("'|u1'") != std::string::npos) {
+        element = Element::UInt8;
+        elementSize = 1;
+    } else {
+        throw std::runtime_error("Unsupported .npy dtype (expected <f4, <f8 or |u1)");
+    }
+
+    size_t shapeStart = header.find('(', header.find("'shape'"));
+    size_t shapeEnd = header.find(')', shapeStart);
+    if (shapeStart == std::string::npos || shapeEnd == std::string::npos) {
+        throw std::runtime_error("Invalid .npy shape");
+    }
+    std::vector<size_t> shape;
+    std::string dims = header.substr(shapeStart + 1, shapeEnd - shapeStart - 1);
+    size_t pos = 0;
+    while (pos < dims.size()) {
+        size_t comma = dims.find(',', pos);
+        std::string token = dims.substr(pos, comma == std::string::npos ? std::string::npos : comma - pos);
+        if (token.find_first_of("0123456789") != std::string::npos) {
+            shape.push_back(std::stoull(token));
+        }
+        if (comma == std::string::npos) {
+            break;
+        }
+        pos = comma + 1;
+    }
+    if (shape.size() != 2) {
+        throw std::runtime_error(".npy array must have shape (N, D)");
+    }
+
+    count = shape[0];
+    dimension = shape[1];
+    rowPrefix = 0;
+    rowStride = dimension * elementSize;
+    if (headerBytes + count * rowStride > length) {
+        throw std::runtime_error(".npy file is truncated");
+    }
+}
+
+template <typename T>
+void VectorFile::readRow(size_t index, T* out) const {
+    const unsigned char* row = data + headerBytes + index * rowStride + rowPrefix;
+    switch (element) {
+        case Element::Float32:
+            for (size_t i = 0; i < dimension; ++i) {
+                float value;
+                std::memcpy(&value, row + i * sizeof(float), sizeof(float));
+                out[i] = value;
+            }
+            break;
+        case Element::Float64:
+            for (size_t i = 0; i < dimension; ++i) {
+                double value;
+                std::memcpy(&value, row + i * sizeof(double), sizeof(double));
+                out[i] = static_cast<float>(value);
+            }
+            break;
+        case Element::UInt8:
+            for (size_t i = 0; i < dimension; ++i) {
+                out[i] = static_cast<float>(row[i]);
+            }
+            break;
+    }
+}
+
+void VectorFile::read(size_t index, NType* out) const {
+    readRow(index, out);
+}
+
+void VectorFile::read(size_t index, float* out) const {
+    readRow(index, out);
+}
+
+Point VectorFile::point(size_t index) const {
+    Point result(dimension);
+    read(index, result.data());
+    return result;
+}
+
+VectorWriter::VectorWriter(const std::string& fileName, bool append)
+    : fileName(fileName), out(fileName, std::ios::binary | (append ? std::ios::app : std::ios::trunc)) {
+    if (!out) {
+        throw std::runtime_error("Cannot create vector file: " + fileName);
+    }
+}
+
+void VectorWriter::write(const float* row, size_t dim) {
+    if (dimension == 0) {
+        dimension = dim;
+    } else if (dim != dimension) {
+        throw std::runtime_error("Row of dimension " + std::to_string(dim) + " in vector file of dimension " +
+                                 std::to_string(dimension) + ": " + fileName);
+    }
+    int32_t header = static_cast<int32_t>(dim);
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.write(reinterpret_cast<const char*>(row), dim * sizeof(float));
+    ++count;
+}
+
+void VectorWriter::write(const Point& point) {
+    std::vector<float> row(point.dim());
+    for (size_t i = 0; i < row.size(); ++i) {
+        row[i] = point[i].getValue();
+    }
+    write(row.data(), row.size());
+}
+
+void VectorWriter::close() {
+    out.close();
+    if (!out) {
+        throw std::runtime_error("Error writing vector file: " + fileName);
+    }
+}
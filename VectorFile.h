@@ -0,0 +1,76 @@
+#ifndef VECTOR_FILE_H
+#define VECTOR_FILE_H
+
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "params.h"
+#include "Point.h"
+
+// Archivo de vectores planos mapeado en memoria: .fvecs, .bvecs o .npy (matriz N x D).
+// Las filas se leen directamente del mapeo, sin interpretar texto.
+class VectorFile {
+private:
+    enum class Format { FVecs, BVecs, Npy };
+    enum class Element { Float32, Float64, UInt8 };
+
+    Format format;
+    Element element;
+    const unsigned char* data = nullptr;
+    size_t length = 0;
+    size_t count = 0;
+    size_t dimension = 0;
+    size_t headerBytes = 0;     // bytes antes de la primera fila
+    size_t rowPrefix = 0;       // bytes antes de las coordenadas de cada fila (la dimensión en .fvecs/.bvecs)
+    size_t rowStride = 0;       // bytes entre filas consecutivas
+
+    void parseVecs(size_t elementSize);
+    void parseNpy();
+
+    template <typename T>
+    void readRow(size_t index, T* out) const;
+
+public:
+    explicit VectorFile(const std::string& fileName);
+    ~VectorFile();
+
+    VectorFile(const VectorFile&) = delete;
+    VectorFile& operator=(const VectorFile&) = delete;
+
+    size_t size() const {
+        return count;
+    }
+    size_t dim() const {
+        return dimension;
+    }
+
+    // Copia las coordenadas de la fila index en out (dim() valores)
+    void read(size_t index, NType* out) const;
+    void read(size_t index, float* out) const;
+    Point point(size_t index) const;
+};
+
+// Escribe filas en formato .fvecs (dimensión como int32 y luego las coordenadas en float32), el mismo
+// que lee VectorFile. Con append las filas se agregan al final de un archivo existente.
+class VectorWriter {
+private:
+    std::string fileName;
+    std::ofstream out;
+    size_t dimension = 0;       // la de la primera fila; todas deben coincidir
+    size_t count = 0;
+
+public:
+    explicit VectorWriter(const std::string& fileName, bool append = false);
+
+    void write(const float* row, size_t dim);
+    void write(const Point& point);
+    // Vacía el buffer y lanza std::runtime_error si alguna escritura falló
+    void close();
+
+    size_t size() const {
+        return count;
+    }
+};
+
+#endif // VECTOR_FILE_H
@@ -0,0 +1,240 @@
+#include <benchmark/benchmark.h>
+#include <map>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <utility>
+#include <vector>
+#include "SStree.h"
+#include "ClusterGenerator.h"
+
+// Microbenchmarks del SS-tree con Google Benchmark. La salida legible por máquina se pide con las
+// opciones de la biblioteca, p. ej.:
+//   ss_tree_bench --benchmark_format=json > bench.json
+//   ss_tree_bench --benchmark_out=bench.csv --benchmark_out_format=csv
+//   ss_tree_bench --benchmark_filter=KNN
+//
+// Argumentos de cada benchmark: dimensión y, según el caso, cantidad de puntos y k.
+
+// Datos y árboles compartidos entre benchmarks: se generan una vez por (n, dim)
+const std::vector<Point>& dataset(size_t n, size_t dim) {
+    static std::map<std::pair<size_t, size_t>, std::vector<Point>> cache;
+    auto it = cache.find({n, dim});
+    if (it == cache.end()) {
+        std::mt19937 gen(42);
+        std::vector<Point> centers = clusterCenters(dim, gen);
+        it = cache.emplace(std::make_pair(n, dim), sampleClusters(centers, n, gen)).first;
+    }
+    return it->second;
+}
+
+// Consultas de la misma distribución que dataset(): los centros de la semilla 42 con ruido de otra semilla
+const std::vector<Point>& queries(size_t dim) {
+    static std::map<size_t, std::vector<Point>> cache;
+    auto it = cache.find(dim);
+    if (it == cache.end()) {
+        std::mt19937 centersGen(42);
+        std::vector<Point> centers = clusterCenters(dim, centersGen);
+        std::mt19937 gen(7);
+        it = cache.emplace(dim, sampleClusters(centers, 256, gen)).first;
+    }
+    return it->second;
+}
+
+SsTreeParams benchParams(size_t dim) {
+    // Mismo ajuste de capacidades por defecto que ss_tree_indexing
+    SsTreeParams params = SsTreeParams::forDimension(dim, 16384);
+    params.nodeBytes = 16384;
+    return params;
+}
+
+const SsTree& tree(size_t n, size_t dim) {
+    static std::map<std::pair<size_t, size_t>, std::unique_ptr<SsTree>> cache;
+    auto it = cache.find({n, dim});
+    if (it == cache.end()) {
+        auto built = std::make_unique<SsTree>(benchParams(dim));
+        built->bulkLoad(std::vector<Point>(dataset(n, dim)));
+        it = cache.emplace(std::make_pair(n, dim), std::move(built)).first;
+    }
+    return *it->second;
+}
+
+// Núcleo de distancia (las dimensiones de FixedDims usan la versión especializada; 100 la genérica)
+static void BM_SquaredDistance(benchmark::State& state) {
+    size_t dim = state.range(0);
+    const std::vector<Point>& points = dataset(1024, dim);
+    size_t i = 0;
+    for (auto _ : state) {
+        const Point& a = points[i & 1023];
+        const Point& b = points[(i + 1) & 1023];
+        benchmark::DoNotOptimize(squaredDistance(a.data(), b.data(), dim));
+        ++i;
+    }
+    state.SetItemsProcessed(state.iterations());
+    state.SetBytesProcessed(state.iterations() * 2 * dim * sizeof(NType));
+}
+BENCHMARK(BM_SquaredDistance)->Arg(50)->Arg(100)->Arg(128)->Arg(512)->Arg(2048);
+
+// El mismo núcleo sobre filas FixedPoint<N> contiguas: sin un std::vector por punto ni elección de núcleo
+template <size_t N>
+static void BM_SquaredDistanceFixedPoint(benchmark::State& state) {
+    const std::vector<Point>& points = dataset(1024, N);
+    std::vector<FixedPoint<N>> rows;
+    rows.reserve(points.size());
+    for (const Point& point : points) {
+        rows.emplace_back(point);
+    }
+    size_t i = 0;
+    for (auto _ : state) {
+        const FixedPoint<N>& a = rows[i & 1023];
+        const FixedPoint<N>& b = rows[(i + 1) & 1023];
+        benchmark::DoNotOptimize(squaredDistanceFixed<N>(a.data(), b.data()));
+        ++i;
+    }
+    state.SetItemsProcessed(state.iterations());
+    state.SetBytesProcessed(state.iterations() * 2 * N * sizeof(NType));
+}
+BENCHMARK_TEMPLATE(BM_SquaredDistanceFixedPoint, 50);
+BENCHMARK_TEMPLATE(BM_SquaredDistanceFixedPoint, 128);
+BENCHMARK_TEMPLATE(BM_SquaredDistanceFixedPoint, 512);
+BENCHMARK_TEMPLATE(BM_SquaredDistanceFixedPoint, 2048);
+
+// Recorrido de una hoja llena durante una consulta kNN
+static void BM_LeafScan(benchmark::State& state) {
+    size_t dim = state.range(0);
+    size_t k = state.range(1);
+    SsTreeParams params = benchParams(dim);
+    const std::vector<Point>& points = dataset(params.leafMax, dim);
+    SsLeaf leaf;
+    leaf.points = points;
+    leaf.updateBoundingEnvelope();
+    const std::vector<Point>& qs = queries(dim);
+
+    size_t i = 0;
+    for (auto _ : state) {
+        NeighborHeap L;
+        NType Dk = std::numeric_limits<float>::max();
+        leaf.FNDFTrav(qs[i++ % qs.size()], k, L, Dk, nullptr);
+        benchmark::DoNotOptimize(Dk);
+    }
+    state.SetItemsProcessed(state.iterations() * points.size());
+    state.counters["leafSize"] = static_cast<double>(points.size());
+}
+BENCHMARK(BM_LeafScan)->Args({50, 10})->Args({128, 10})->Args({512, 10})->Args({2048, 10});
+
+// División de una hoja desbordada con cada política
+static void BM_LeafSplit(benchmark::State& state) {
+    size_t dim = state.range(0);
+    SsTreeParams params = benchParams(dim);
+    params.split = static_cast<SplitPolicy>(state.range(1));
+    const std::vector<Point>& points = dataset(params.leafMax + 1, dim);
+
+    for (auto _ : state) {
+        state.PauseTiming();
+        SsLeaf leaf;
+        leaf.points = points;
+        leaf.updateBoundingEnvelope();
+        state.ResumeTiming();
+        std::pair<SsNode*, SsNode*> halves = leaf.split(params);
+        benchmark::DoNotOptimize(halves);
+        state.PauseTiming();
+        delete halves.first;
+        delete halves.second;
+        state.ResumeTiming();
+    }
+    state.SetLabel(params.split == SplitPolicy::MaxVariance ? "MaxVariance"
+                   : params.split == SplitPolicy::MinOverlap ? "MinOverlap" : "KMeans");
+}
+BENCHMARK(BM_LeafSplit)
+    ->Args({128, static_cast<int>(SplitPolicy::MaxVariance)})
+    ->Args({128, static_cast<int>(SplitPolicy::MinOverlap)})
+    ->Args({128, static_cast<int>(SplitPolicy::KMeans)});
+
+// Construcción por inserciones uno a uno (incluye divisiones)
+static void BM_Insert(benchmark::State& state) {
+    size_t n = state.range(0);
+    size_t dim = state.range(1);
+    const std::vector<Point>& points = dataset(n, dim);
+    for (auto _ : state) {
+        SsTree built(benchParams(dim));
+        for (const Point& point : points) {
+            built.insert(point);
+        }
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * n);
+}
+BENCHMARK(BM_Insert)->Args({10000, 50})->Args({10000, 128})->Args({10000, 512})->Unit(benchmark::kMillisecond);
+
+// Construcción por empaquetado (bulk load)
+static void BM_BulkLoad(benchmark::State& state) {
+    size_t n = state.range(0);
+    size_t dim = state.range(1);
+    const std::vector<Point>& points = dataset(n, dim);
+    for (auto _ : state) {
+        state.PauseTiming();
+        std::vector<Point> copy(points);
+        state.ResumeTiming();
+        SsTree built(benchParams(dim));
+        built.bulkLoad(std::move(copy));
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * n);
+}
+BENCHMARK(BM_BulkLoad)->Args({10000, 128})->Args({100000, 128})->Args({10000, 512})->Unit(benchmark::kMillisecond);
+
+// Consulta kNN sobre árboles empaquetados
+static void BM_KNN(benchmark::State& state) {
+    size_t n = state.range(0);
+    size_t dim = state.range(1);
+    size_t k = state.range(2);
+    const SsTree& index = tree(n, dim);
+    const std::vector<Point>& qs = queries(dim);
+
+    QueryStats stats;
+    size_t i = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(index.kNNSearch(qs[i++ % qs.size()], k, &stats));
+    }
+    state.SetItemsProcessed(state.iterations());
+    state.counters["leaves"] = benchmark::Counter(static_cast<double>(stats.leavesVisited), benchmark::Counter::kAvgIterations);
+    state.counters["inner"] = benchmark::Counter(static_cast<double>(stats.innerVisited), benchmark::Counter::kAvgIterations);
+}
+BENCHMARK(BM_KNN)
+    ->ArgsProduct({{10000, 100000}, {50, 128}, {1, 10, 100}})
+    ->Args({10000, 512, 10})
+    ->Args({10000, 2048, 10})
+    ->Unit(benchmark::kMicrosecond);
+
+// Serialización del árbol completo en memoria (sin el costo del disco)
+static void BM_Save(benchmark::State& state) {
+    size_t n = state.range(0);
+    size_t dim = state.range(1);
+    const SsTree& index = tree(n, dim);
+    size_t bytes = 0;
+    for (auto _ : state) {
+        std::ostringstream out;
+        index.saveToStream(out);
+        bytes = out.tellp();
+    }
+    state.SetBytesProcessed(state.iterations() * bytes);
+}
+BENCHMARK(BM_Save)->Args({100000, 128})->Unit(benchmark::kMillisecond);
+
+static void BM_Load(benchmark::State& state) {
+    size_t n = state.range(0);
+    size_t dim = state.range(1);
+    std::ostringstream out;
+    tree(n, dim).saveToStream(out);
+    std::string serialized = out.str();
+    for (auto _ : state) {
+        std::istringstream in(serialized);
+        SsTree loaded;
+        loaded.loadFromStream(in);
+        benchmark::ClobberMemory();
+    }
+    state.SetBytesProcessed(state.iterations() * serialized.size());
+}
+BENCHMARK(BM_Load)->Args({100000, 128})->Unit(benchmark::kMillisecond);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,344 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <random>
+#include <thread>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+#include <cctype>
+#include <stdexcept>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+// Servicio de embeddings local para pruebas y mediciones: acepta las mismas peticiones multipart que
+// CortexAPI (uno o varios campos "image") y responde, por cada imagen, un embedding determinista derivado
+// del hash de sus bytes: float32 binario si la petición acepta application/octet-stream y, si no, una
+// línea CSV por imagen. Mantiene las conexiones abiertas (HTTP/1.1 keep-alive).
+//
+// uso: cortex_stub [--port 8080] [--dim 2048] [--latency-ms 0] [--format auto|csv|json]
+
+struct StubOptions {
+    int port = 8080;
+    size_t dim = 2048;
+    int latencyMs = 0;      // demora artificial por petición, para simular la red
+    std::string format = "auto";    // auto: binario si el cliente lo acepta; csv o json fuerzan el texto
+};
+
+// FNV-1a de 64 bits
+uint64_t hashBytes(const char* data, size_t length) {
+    uint64_t hash = 1469598103934665603ULL;
+    for (size_t i = 0; i < length; ++i) {
+        hash ^= static_cast<unsigned char>(data[i]);
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+// Vector unitario: la misma imagen produce siempre el mismo embedding
+std::vector<float> embedding(const char* image, size_t length, size_t dim) {
+    std::mt19937_64 gen(hashBytes(image, length));
+    std::normal_distribution<float> normal(0.0f, 1.0f);
+    std::vector<float> values(dim);
+    double norm = 0;
+    for (float& value : values) {
+        value = normal(gen);
+        norm += value * value;
+    }
+    norm = std::sqrt(norm);
+    for (float& value : values) {
+        value /= norm;
+    }
+    return values;
+}
+
+void appendEmbedding(std::string& out, const std::vector<float>& values, const std::string& format) {
+    if (format == "binary") {
+        out.append(reinterpret_cast<const char*>(values.data()), values.size() * sizeof(float));
+        return;
+    }
+    bool json = format == "json";
+    if (json) {
+        out += out.empty() ? "{\"dim\": " + std::to_string(values.size()) + ", \"embeddings\": [[" : ", [";
+    }
+    char number[32];
+    for (size_t i = 0; i < values.size(); ++i) {
+        int written = std::snprintf(number, sizeof(number), i == 0 ? "%.7g" : ",%.7g", values[i]);
+        out.append(number, written);
+    }
+    out += json ? "]" : "\n";
+}
+
+std::string lowercase(std::string text) {
+    std::transform(text.begin(), text.end(), text.begin(), [](unsigned char c) { return std::tolower(c); });
+    return text;
+}
+
+// Valor de la cabecera name (sin distinguir mayúsculas) o "" si no está
+std::string headerValue(const std::string& headers, const std::string& name) {
+    std::string lower = lowercase(headers);
+    size_t pos = lower.find("\r\n" + name + ":");
+    if (pos == std::string::npos) {
+        return "";
+    }
+    size_t start = headers.find_first_not_of(' ', pos + name.size() + 3);
+    size_t end = headers.find("\r\n", start);
+    return headers.substr(start, end - start);
+}
+
+class Connection {
+private:
+    int fd;
+    std::string buffer;
+
+    bool fill() {
+        char chunk[65536];
+        ssize_t received = recv(fd, chunk, sizeof(chunk), 0);
+        if (received <= 0) {
+            return false;
+        }
+        buffer.append(chunk, received);
+        return true;
+    }
+
+public:
+    explicit Connection(int fd) : fd(fd) {}
+    ~Connection() {
+        close(fd);
+    }
+
+    // Extrae lo que hay antes del siguiente delimiter, o los siguientes length bytes
+    bool readUntil(const std::string& delimiter, std::string& out) {
+        size_t pos;
+        while ((pos = buffer.find(delimiter)) == std::string::npos) {
+            if (!fill()) {
+                return false;
+            }
+        }
+        out = buffer.substr(0, pos);
+        buffer.erase(0, pos + delimiter.size());
+        return true;
+    }
+    bool readBytes(size_t length, std::string& out) {
+        while (buffer.size() < length) {
+            if (!fill()) {
+                return false;
+            }
+        }
+        out.append(buffer, 0, length);
+        buffer.erase(0, length);
+        return true;
+    }
+
+    bool send(const std::string& data) {
+        size_t sent = 0;
+        while (sent < data.size()) {
+            ssize_t n = ::send(fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+            if (n <= 0) {
+                return false;
+            }
+            sent += n;
+        }
+        return true;
+    }
+};
+
+std::string mediaType(const std::string& format) {
+    if (format == "binary") {
+        return "application/octet-stream";
+    }
+    if (format == "json") {
+        return "application/json";
+    }
+    return format == "csv" ? "text/csv" : "text/plain";
+}
+
+// Tamaño en la base dada (10 para Content-Length, 16 para los bloques); std::stoul solo no basta porque
+// acepta signos, espacios iniciales y basura al final. Lanza std::invalid_argument o std::out_of_range
+size_t parseSize(std::string text, int base) {
+    text = text.substr(0, text.find(';'));   // extensiones de bloque
+    text.erase(text.find_last_not_of(' ') + 1);
+    bool digits = !text.empty() && std::all_of(text.begin(), text.end(), [base](unsigned char c) {
+        return base == 16 ? std::isxdigit(c) : std::isdigit(c);
+    });
+    if (!digits) {
+        throw std::invalid_argument("Tamaño inválido: " + text);
+    }
+    return std::stoul(text, nullptr, base);
+}
+
+// Lanza una excepción si el Content-Length o el tamaño de un bloque no se pueden leer
+bool readBody(Connection& connection, const std::string& headers, std::string& body) {
+    if (lowercase(headerValue(headers, "transfer-encoding")) == "chunked") {
+        std::string sizeLine;
+        while (connection.readUntil("\r\n", sizeLine)) {
+            size_t size = parseSize(sizeLine, 16);
+            std::string crlf;
+            if (size == 0) {
+                return connection.readUntil("\r\n", crlf);
+            }
+            if (!connection.readBytes(size, body) || !connection.readBytes(2, crlf)) {
+                return false;
+            }
+        }
+        return false;
+    }
+    std::string length = headerValue(headers, "content-length");
+    return connection.readBytes(length.empty() ? 0 : parseSize(length, 10), body);
+}
+
+// Un embedding por cada parte "image" del formulario, en orden
+std::string embedForm(const std::string& body, const std::string& contentType, size_t dim, const std::string& format) {
+    size_t boundaryPos = contentType.find("boundary=");
+    if (boundaryPos == std::string::npos) {
+        return "";
+    }
+    std::string boundary = contentType.substr(boundaryPos + 9);
+    if (!boundary.empty() && boundary.front() == '"') {
+        boundary = boundary.substr(1, boundary.find('"', 1) - 1);
+    }
+    std::string delimiter = "--" + boundary;
+
+    std::string response;
+    size_t pos = body.find(delimiter);
+    while (pos != std::string::npos) {
+        size_t partStart = pos + delimiter.size();
+        if (body.compare(partStart, 2, "--") == 0) {
+            break;
+        }
+        size_t headersEnd = body.find("\r\n\r\n", partStart);
+        size_t next = body.find("\r\n" + delimiter, partStart);
+        if (headersEnd == std::string::npos || next == std::string::npos) {
+            break;
+        }
+        std::string partHeaders = body.substr(partStart, headersEnd - partStart);
+        if (partHeaders.find("name=\"image\"") != std::string::npos) {
+            size_t contentStart = headersEnd + 4;
+            appendEmbedding(response, embedding(body.data() + contentStart, next - contentStart, dim), format);
+        }
+        pos = next + 2;
+    }
+    if (format == "json" && !response.empty()) {
+        response += "]}";
+    }
+    return response;
+}
+
+void serve(int fd, const StubOptions& options) {
+    Connection connection(fd);
+    std::string requestLine;
+    while (connection.readUntil("\r\n", requestLine)) {
+        std::string headers;
+        if (!connection.readUntil("\r\n\r\n", headers)) {
+            return;
+        }
+        headers = "\r\n" + headers + "\r\n";
+        if (lowercase(headerValue(headers, "expect")) == "100-continue") {
+            connection.send("HTTP/1.1 100 Continue\r\n\r\n");
+        }
+        std::string body;
+        bool complete = false;
+        try {
+            complete = readBody(connection, headers, body);
+        } catch (std::exception&) {
+            // Sin un largo válido no se sabe dónde termina el cuerpo: se responde y se cierra la conexión
+            connection.send("HTTP/1.1 400 Bad Request\r\nContent-Length: 0\r\nConnection: close\r\n\r\n");
+            return;
+        }
+        if (!complete) {
+            return;
+        }
+
+        std::string payload;
+        std::string status = "200 OK";
+        std::string format = options.format;
+        if (format == "auto") {
+            bool binary = lowercase(headerValue(headers, "accept")).find("application/octet-stream") != std::string::npos;
+            format = binary ? "binary" : "csv";
+        }
+        if (requestLine.compare(0, 5, "POST ") != 0) {
+            status = "405 Method Not Allowed";
+        } else {
+            payload = embedForm(body, headerValue(headers, "content-type"), options.dim, format);
+            if (payload.empty()) {
+                status = "400 Bad Request";
+            }
+        }
+        if (options.latencyMs > 0) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(options.latencyMs));
+        }
+
+        bool keepAlive = lowercase(headerValue(headers, "connection")) != "close";
+        std::string response = "HTTP/1.1 " + status + "\r\nContent-Type: " + mediaType(payload.empty() ? "" : format) +
+                               "\r\nContent-Length: " +
+                               std::to_string(payload.size()) + "\r\n" +
+                               (keepAlive ? "Connection: keep-alive\r\n\r\n" : "Connection: close\r\n\r\n") + payload;
+        if (!connection.send(response) || !keepAlive) {
+            return;
+        }
+    }
+}
+
+void printUsage(const char* program) {
+    std::cerr << "uso: " << program << " [--port 8080] [--dim 2048] [--latency-ms 0] [--format auto|csv|json]"
+              << std::endl;
+}
+
+int main(int argc, char** argv) {
+    StubOptions options;
+    try {
+        for (int i = 1; i + 1 < argc; i += 2) {
+            std::string arg = argv[i];
+            if (arg == "--port") {
+                options.port = std::stoi(argv[i + 1]);
+            } else if (arg == "--dim") {
+                options.dim = std::stoul(argv[i + 1]);
+            } else if (arg == "--latency-ms") {
+                options.latencyMs = std::stoi(argv[i + 1]);
+            } else if (arg == "--format") {
+                options.format = argv[i + 1];
+            } else {
+                printUsage(argv[0]);
+                return 1;
+            }
+        }
+        // Un embedding vacío no tiene norma con la que normalizarse
+        if (options.dim == 0) {
+            throw std::invalid_argument("--dim debe ser mayor que 0");
+        }
+    } catch (std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    int server = socket(AF_INET, SOCK_STREAM, 0);
+    int reuse = 1;
+    setsockopt(server, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    address.sin_port = htons(options.port);
+    if (bind(server, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 || listen(server, 64) != 0) {
+        std::cerr << "No se pudo escuchar en el puerto " << options.port << std::endl;
+        return 1;
+    }
+    std::cout << "cortex_stub en http://127.0.0.1:" << options.port << " (dim " << options.dim << ")" << std::endl;
+
+    while (true) {
+        int client = accept(server, nullptr, nullptr);
+        if (client < 0) {
+            continue;
+        }
+        // Una excepción que escapara de un hilo separado terminaría todo el servicio
+        std::thread([client, options]() {
+            try {
+                serve(client, options);
+            } catch (std::exception& e) {
+                std::cerr << "Conexión descartada: " << e.what() << std::endl;
+            }
+        }).detach();
+    }
+}
@@ -0,0 +1,304 @@
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <deque>
+#include <string>
+#include <random>
+#include <chrono>
+#include <thread>
+#include <future>
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include "VectorFile.h"
+#include "ThreadPool.h"
+
+// Genera conjuntos sintéticos reproducibles (misma semilla, mismo archivo, con cualquier cantidad de
+// hilos) con la estructura de embeddings reales: clusters gaussianos de tamaños desiguales, ejes de
+// distinta varianza, datos en un subespacio de dimensión intrínseca menor y, opcionalmente, vectores
+// normalizados. La salida es .fvecs, la entrada que ss_tree_indexing lee directamente.
+//
+// Los puntos se generan en un espacio latente de dimensión intrinsic y se llevan a dim dimensiones con
+// una base ortonormal aleatoria, así las distancias del espacio latente se conservan.
+
+struct DatasetOptions {
+    std::string output = "../synthetic.fvecs";
+    std::string queries;            // vacío: no se generan consultas
+    size_t count = 100000;
+    size_t queryCount = 1000;
+    size_t dim = 128;
+    size_t intrinsic = 0;           // 0: igual a dim
+    size_t clusters = 20;           // 0: uniforme en el cubo (el peor caso del SS-tree)
+    double spread = 0.1;            // desviación de cada cluster, relativa al cubo [-1, 1] de los centros
+    double anisotropy = 1.0;        // razón entre el eje más ancho y el más angosto de cada cluster
+    double noise = 0.01;            // ruido en todas las dimensiones cuando intrinsic < dim
+    bool normalize = false;         // norma 1, como los embeddings que se comparan por coseno
+    uint32_t seed = 42;
+    size_t threads = std::max(1u, std::thread::hardware_concurrency());
+};
+
+// Parámetros de la distribución, derivados solo de la semilla
+struct SyntheticModel {
+    size_t dim = 0;
+    size_t latent = 0;
+    std::vector<std::vector<float>> centers;    // clusters x latent
+    std::vector<std::vector<float>> scales;     // desviación por eje latente de cada cluster
+    std::vector<double> weights;                // tamaño relativo de cada cluster
+    std::vector<float> basis;                   // dim x latent, columnas ortonormales; vacío si no hace falta
+    double noise = 0;
+    bool normalize = false;
+    bool uniform = false;
+};
+
+SyntheticModel buildModel(const DatasetOptions& options) {
+    SyntheticModel model;
+    model.dim = options.dim;
+    model.latent = options.intrinsic == 0 ? options.dim : options.intrinsic;
+    model.noise = model.latent < model.dim ? options.noise : 0.0;
+    model.normalize = options.normalize;
+    model.uniform = options.clusters == 0;
+
+    std::mt19937 gen(options.seed);
+    std::uniform_real_distribution<float> cube(-1.0f, 1.0f);
+    std::uniform_real_distribution<double> unit(0.0, 1.0);
+    std::exponential_distribution<double> size(1.0);
+    for (size_t c = 0; c < options.clusters; ++c) {
+        std::vector<float> center(model.latent);
+        std::vector<float> scale(model.latent);
+        for (size_t j = 0; j < model.latent; ++j) {
+            center[j] = cube(gen);
+            // Escala log-uniforme entre spread / anisotropy y spread
+            scale[j] = static_cast<float>(options.spread * std::pow(options.anisotropy, -unit(gen)));
+        }
+        model.centers.push_back(std::move(center));
+        model.scales.push_back(std::move(scale));
+        model.weights.push_back(size(gen));
+    }
+
+    // Con anisotropía los ejes se rotan aunque no se reduzca la dimensión: si no, la dirección de mayor
+    // varianza coincidiría con una coordenada y favorecería a las divisiones por eje
+    if (model.latent < model.dim || options.anisotropy > 1.0) {
+        std::normal_distribution<float> normal(0.0f, 1.0f);
+        model.basis.resize(model.dim * model.latent);
+        for (size_t c = 0; c < model.latent; ++c) {
+            std::vector<float> column(model.dim);
+            for (float& value : column) {
+                value = normal(gen);
+            }
+            // Gram-Schmidt contra las columnas anteriores
+            for (size_t prev = 0; prev < c; ++prev) {
+                float dot = 0;
+                for (size_t r = 0; r < model.dim; ++r) {
+                    dot += column[r] * model.basis[r * model.latent + prev];
+                }
+                for (size_t r = 0; r < model.dim; ++r) {
+                    column[r] -= dot * model.basis[r * model.latent + prev];
+                }
+            }
+            float norm = 0;
+            for (float value : column) {
+                norm += value * value;
+            }
+            norm = std::sqrt(norm);
+            for (size_t r = 0; r < model.dim; ++r) {
+                model.basis[r * model.latent + c] = column[r] / norm;
+            }
+        }
+    }
+    return model;
+}
+
+// Filas [first, first + count) del flujo stream (0 = datos, 1 = consultas). Cada bloque tiene su propio
+// generador, así el resultado no depende de cuántos hilos lo calculen.
+std::vector<float> generateRows(const SyntheticModel& model, uint32_t seed, uint32_t stream, size_t first,
+                                size_t count) {
+    std::seed_seq sequence{seed, stream, static_cast<uint32_t>(first), static_cast<uint32_t>(first >> 32)};
+    std::mt19937 gen(sequence);
+    std::uniform_real_distribution<float> cube(-1.0f, 1.0f);
+    std::normal_distribution<float> normal(0.0f, 1.0f);
+    std::discrete_distribution<size_t> pick(model.weights.begin(), model.weights.end());
+
+    std::vector<float> rows(count * model.dim);
+    std::vector<float> latent(model.latent);
+    for (size_t i = 0; i < count; ++i) {
+        if (model.uniform) {
+            for (float& value : latent) {
+                value = cube(gen);
+            }
+        } else {
+            size_t cluster = pick(gen);
+            const std::vector<float>& center = model.centers[cluster];
+            const std::vector<float>& scale = model.scales[cluster];
+            for (size_t j = 0; j < model.latent; ++j) {
+                latent[j] = center[j] + scale[j] * normal(gen);
+            }
+        }
+
+        float* row = rows.data() + i * model.dim;
+        if (model.basis.empty()) {
+            std::copy(latent.begin(), latent.end(), row);
+        } else {
+            for (size_t r = 0; r < model.dim; ++r) {
+                const float* weights = model.basis.data() + r * model.latent;
+                float value = 0;
+                for (size_t j = 0; j < model.latent; ++j) {
+                    value += weights[j] * latent[j];
+                }
+                row[r] = value + (model.noise > 0 ? static_cast<float>(model.noise) * normal(gen) : 0.0f);
+            }
+        }
+
+        if (model.normalize) {
+            float norm = 0;
+            for (size_t r = 0; r < model.dim; ++r) {
+                norm += row[r] * row[r];
+            }
+            norm = std::sqrt(norm);
+            if (norm > 0) {
+                for (size_t r = 0; r < model.dim; ++r) {
+                    row[r] /= norm;
+                }
+            }
+        }
+    }
+    return rows;
+}
+
+// Escribe count filas del flujo en fileName, generando bloques en paralelo con una ventana acotada
+void writeStream(const SyntheticModel& model, const DatasetOptions& options, ThreadPool& workers, uint32_t stream,
+                 const std::string& fileName, size_t count) {
+    const size_t BLOCK = 4096;
+    VectorWriter writer(fileName);
+    std::deque<std::future<std::vector<float>>> inFlight;
+    size_t next = 0;
+    uint32_t seed = options.seed;
+    while (next < count || !inFlight.empty()) {
+        while (next < count && inFlight.size() < options.threads * 2) {
+            size_t first = next;
+            size_t rows = std::min(BLOCK, count - next);
+            inFlight.push_back(workers.submit([&model, seed, stream, first, rows]() {
+                return generateRows(model, seed, stream, first, rows);
+            }));
+            next += rows;
+        }
+        std::vector<float> block = inFlight.front().get();
+        inFlight.pop_front();
+        for (size_t i = 0; i * model.dim < block.size(); ++i) {
+            writer.write(block.data() + i * model.dim, model.dim);
+        }
+    }
+    writer.close();
+}
+
+void generateDataset(const DatasetOptions& options) {
+    if (options.intrinsic > options.dim) {
+        throw std::invalid_argument("--intrinsic no puede superar a --dim");
+    }
+    auto start = std::chrono::steady_clock::now();
+    SyntheticModel model = buildModel(options);
+    ThreadPool workers(options.threads);
+
+    writeStream(model, options, workers, 0, options.output, options.count);
+    if (!options.queries.empty()) {
+        writeStream(model, options, workers, 1, options.queries, options.queryCount);
+    }
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cout << options.count << " puntos de dimensión " << model.dim << " (intrínseca " << model.latent << ", ";
+    if (model.uniform) {
+        std::cout << "uniformes";
+    } else {
+        std::cout << model.centers.size() << " clusters, anisotropía " << options.anisotropy;
+    }
+    std::cout << (model.normalize ? ", normalizados" : "") << ") en " << options.output;
+    if (!options.queries.empty()) {
+        std::cout << " y " << options.queryCount << " consultas en " << options.queries;
+    }
+    std::cout << " (" << std::fixed << std::setprecision(2) << seconds << " s, semilla " << options.seed << ")"
+              << std::endl;
+}
+
+void printUsage(const char* program) {
+    std::cout << "uso: " << program << " [opciones]\n"
+              << "  -o, --output ARCHIVO    vectores de salida .fvecs (por defecto ../synthetic.fvecs)\n"
+              << "  -q, --queries ARCHIVO   además genera consultas de la misma distribución en ARCHIVO\n"
+              << "  -n, --count N           cantidad de puntos (100000)\n"
+              << "      --query-count N     cantidad de consultas (1000)\n"
+              << "  -d, --dim N             dimensión de los vectores (128)\n"
+              << "      --intrinsic N       dimensión intrínseca (por defecto igual a --dim)\n"
+              << "      --clusters N        clusters gaussianos (20); 0 genera puntos uniformes\n"
+              << "      --spread X          desviación de cada cluster respecto del rango de los centros (0.1)\n"
+              << "      --anisotropy X      razón entre el eje más ancho y el más angosto de un cluster (1)\n"
+              << "      --noise X           ruido fuera del subespacio intrínseco (0.01)\n"
+              << "      --normalize         vectores de norma 1\n"
+              << "      --seed N            semilla (42)\n"
+              << "  -t, --threads N         hilos de generación (no cambia el resultado)\n"
+              << "  -h, --help              muestra esta ayuda" << std::endl;
+}
+
+bool parseArguments(int argc, char** argv, DatasetOptions& options) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        auto value = [&]() -> std::string {
+            if (i + 1 >= argc) {
+                throw std::invalid_argument("Falta el valor de " + arg);
+            }
+            return argv[++i];
+        };
+
+        if (arg == "-h" || arg == "--help") {
+            printUsage(argv[0]);
+            return false;
+        } else if (arg == "-o" || arg == "--output") {
+            options.output = value();
+        } else if (arg == "-q" || arg == "--queries") {
+            options.queries = value();
+        } else if (arg == "-n" || arg == "--count") {
+            options.count = std::max<size_t>(std::stoul(value()), 1);
+        } else if (arg == "--query-count") {
+            options.queryCount = std::max<size_t>(std::stoul(value()), 1);
+        } else if (arg == "-d" || arg == "--dim") {
+            options.dim = std::max<size_t>(std::stoul(value()), 1);
+        } else if (arg == "--intrinsic") {
+            options.intrinsic = std::stoul(value());
+        } else if (arg == "--clusters") {
+            options.clusters = std::stoul(value());
+        } else if (arg == "--spread") {
+            options.spread = std::max(std::stod(value()), 0.0);
+        } else if (arg == "--anisotropy") {
+            options.anisotropy = std::max(std::stod(value()), 1.0);
+        } else if (arg == "--noise") {
+            options.noise = std::max(std::stod(value()), 0.0);
+        } else if (arg == "--normalize") {
+            options.normalize = true;
+        } else if (arg == "--seed") {
+            options.seed = static_cast<uint32_t>(std::stoul(value()));
+        } else if (arg == "-t" || arg == "--threads") {
+            options.threads = std::max<size_t>(std::stoul(value()), 1);
+        } else {
+            throw std::invalid_argument("Opción desconocida: " + arg);
+        }
+    }
+    return true;
+}
+
+int main(int argc, char** argv) {
+    DatasetOptions options;
+    try {
+        if (!parseArguments(argc, argv, options)) {
+            return 0;
+        }
+    } catch (std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    try {
+        generateDataset(options);
+    } catch (std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -3,93 +3,711 @@
 #include <random>
 #include "Point.h"
 #include "SStree.h"
+#include "VectorFile.h"
+#include "BoundedQueue.h"
+#include "SegmentedSsTree.h"
+#include "ShardedSsTree.h"
+#include "IvfSsTree.h"
 #include <hdf5/serial/H5Cpp.h>
 #include <nlohmann/json.hpp>
 #include <fstream>
-
-string myR = "/mnt/c/labo-eda/code/";
+#include <functional>
+#include <thread>
+#include <atomic>
+#include <optional>
+#include <exception>
+#include <iterator>
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <sys/resource.h>
 
 struct ImageData {
     Point embedding;
     std::string path;
 };
 
+// Lote tal como sale de un lector: coordenadas float contiguas (count x dim) y sus rutas
+struct RawBatch {
+    size_t dim = 0;
+    std::vector<float> coordinates;
+    std::vector<std::string> paths;
+};
 
-std::vector<ImageData> readEmbeddingsFromJson(const std::string& FILE_NAME) {
-    std::vector<ImageData> data;
+using BatchCallback = std::function<void(RawBatch&&)>;
 
-    try {
-        std::ifstream file(FILE_NAME);
-        if (!file.is_open()) {
-            throw std::runtime_error("Unable to open JSON file.");
+// Lector SAX de {"features": [[...], ...], "paths": [...]}: no construye el DOM de nlohmann.
+// Las coordenadas se acumulan en un bloque plano de float y cada par (embedding, ruta)
+// se entrega por lotes en cuanto ambas partes están disponibles, sin importar el orden de las claves.
+class EmbeddingJsonReader : public nlohmann::json_sax<nlohmann::json> {
+private:
+    size_t batchSize;
+    BatchCallback onBatch;
+
+    size_t depth = 0;
+    std::string currentKey;
+    size_t featuresDepth = 0;   // profundidad del arreglo "features" (0 si no se está dentro)
+    size_t pathsDepth = 0;      // profundidad del arreglo "paths" (0 si no se está dentro)
+
+    size_t dim = 0;
+    std::vector<float> row;
+    std::vector<float> features;    // filas completas aún no entregadas, contiguas
+    std::vector<std::string> paths; // rutas aún no entregadas
+    size_t consumedRows = 0;        // filas de 'features' ya entregadas
+    size_t consumedPaths = 0;       // rutas de 'paths' ya entregadas
+
+    bool value(float v) {
+        if (featuresDepth != 0 && depth == featuresDepth + 1) {
+            row.push_back(v);
         }
+        return true;
+    }
 
-        nlohmann::json jsonData;
-        file >> jsonData;
-        std::vector<std::vector<float>> features = jsonData["features"].template get<std::vector<std::vector<float>>>();
-        std::vector<std::string> paths = jsonData["paths"].template get<std::vector<std::string>>();
+    void emit(bool flush) {
+        size_t rows = dim == 0 ? 0 : features.size() / dim;
+        size_t ready = std::min(rows - consumedRows, paths.size() - consumedPaths);
+        while (ready >= batchSize || (flush && ready > 0)) {
+            size_t count = std::min(ready, batchSize);
+            RawBatch batch;
+            batch.dim = dim;
+            const float* coordinates = features.data() + consumedRows * dim;
+            batch.coordinates.assign(coordinates, coordinates + count * dim);
+            batch.paths.assign(std::make_move_iterator(paths.begin() + consumedPaths),
+                               std::make_move_iterator(paths.begin() + consumedPaths + count));
+            consumedRows += count;
+            consumedPaths += count;
+            ready -= count;
+            onBatch(std::move(batch));
+        }
+
+        // Compactar cuando la mitad del búfer ya fue entregada: costo amortizado lineal
+        if (consumedRows * 2 > rows && consumedRows > 0) {
+            features.erase(features.begin(), features.begin() + consumedRows * dim);
+            consumedRows = 0;
+        }
+        if (consumedPaths * 2 > paths.size() && consumedPaths > 0) {
+            paths.erase(paths.begin(), paths.begin() + consumedPaths);
+            consumedPaths = 0;
+        }
+    }
+
+public:
+    EmbeddingJsonReader(size_t batchSize, BatchCallback onBatch)
+        : batchSize(std::max<size_t>(batchSize, 1)), onBatch(std::move(onBatch)) {}
+
+    void finish() {
+        emit(true);
+    }
+
+    bool null() override { return true; }
+    bool boolean(bool) override { return true; }
+    bool number_integer(number_integer_t v) override { return value(static_cast<float>(v)); }
+    bool number_unsigned(number_unsigned_t v) override { return value(static_cast<float>(v)); }
+    bool number_float(number_float_t v, const string_t&) override { return value(static_cast<float>(v)); }
+    bool binary(binary_t&) override { return true; }
+
+    bool string(string_t& v) override {
+        if (pathsDepth != 0 && depth == pathsDepth) {
+            paths.push_back(std::move(v));
+            emit(false);
+        }
+        return true;
+    }
 
-        for (size_t i = 0; i < paths.size(); ++i) {
-            Point embedding(features[i].size());
-            for (size_t j = 0; j < features[i].size(); ++j) {
-                embedding[j] = features[i][j];
+    bool key(string_t& v) override {
+        if (depth == 1) {
+            currentKey = v;
+        }
+        return true;
+    }
+
+    bool start_object(std::size_t) override {
+        ++depth;
+        return true;
+    }
+    bool end_object() override {
+        --depth;
+        return true;
+    }
+
+    bool start_array(std::size_t) override {
+        if (depth == 1 && currentKey == "features") {
+            featuresDepth = depth + 1;
+        } else if (depth == 1 && currentKey == "paths") {
+            pathsDepth = depth + 1;
+        } else if (featuresDepth != 0 && depth == featuresDepth) {
+            row.clear();
+        }
+        ++depth;
+        return true;
+    }
+
+    bool end_array() override {
+        --depth;
+        if (featuresDepth != 0 && depth == featuresDepth) {
+            if (dim == 0) {
+                dim = row.size();
             }
-            data.push_back({embedding, paths[i]});
+            if (row.size() != dim) {
+                throw std::runtime_error("Los embeddings deben tener la misma dimensión");
+            }
+            features.insert(features.end(), row.begin(), row.end());
+            emit(false);
+        } else if (depth + 1 == featuresDepth) {
+            featuresDepth = 0;
+        } else if (depth + 1 == pathsDepth) {
+            pathsDepth = 0;
         }
-        
-        file.close();
-    } catch (std::exception& e) {
-        std::cerr << e.what() << std::endl;
+        return true;
+    }
+
+    bool parse_error(std::size_t position, const std::string&, const nlohmann::detail::exception& e) override {
+        throw std::runtime_error("JSON inválido en la posición " + std::to_string(position) + ": " + e.what());
+    }
+};
+
+// Lee embedding.json por partes y entrega lotes de a lo más batchSize pares (embedding, ruta)
+void readEmbeddingsFromJson(const std::string& FILE_NAME, size_t batchSize, const BatchCallback& onBatch) {
+    std::ifstream file(FILE_NAME);
+    if (!file.is_open()) {
+        throw std::runtime_error("Unable to open JSON file.");
     }
 
-    return data;
+    EmbeddingJsonReader reader(batchSize, onBatch);
+    nlohmann::json::sax_parse(file, &reader);
+    reader.finish();
+
+    file.close();
 }
 
-std::vector<ImageData> readEmbeddingsFromHDF5(const H5std_string& FILE_NAME) {
-    std::vector<ImageData> data;
+// Lee las filas [start, start + count) de "features" (N x D, convertidas a float por HDF5) y de "paths"
+RawBatch readHDF5Chunk(const H5::DataSet& featuresDataset, const H5::DataSet& pathsDataset,
+                       hsize_t start, hsize_t count, hsize_t dim) {
+    // Hiperslab de features leído directamente como float nativo
+    RawBatch batch;
+    batch.dim = dim;
+    std::vector<float>& buffer = batch.coordinates;
+    buffer.resize(count * dim);
+    H5::DataSpace featuresSpace = featuresDataset.getSpace();
+    hsize_t featuresOffset[2] = {start, 0};
+    hsize_t featuresCount[2] = {count, dim};
+    featuresSpace.selectHyperslab(H5S_SELECT_SET, featuresCount, featuresOffset);
+    H5::DataSpace featuresMemory(2, featuresCount);
+    featuresDataset.read(buffer.data(), H5::PredType::NATIVE_FLOAT, featuresMemory, featuresSpace);
+
+    // Hiperslab de paths: cadenas de longitud variable o fija
+    std::vector<std::string>& paths = batch.paths;
+    paths.resize(count);
+    H5::StrType strType = pathsDataset.getStrType();
+    H5::DataSpace pathsSpace = pathsDataset.getSpace();
+    hsize_t pathsOffset[1] = {start};
+    hsize_t pathsCount[1] = {count};
+    pathsSpace.selectHyperslab(H5S_SELECT_SET, pathsCount, pathsOffset);
+    H5::DataSpace pathsMemory(1, pathsCount);
+    if (strType.isVariableStr()) {
+        std::vector<char*> raw(count, nullptr);
+        pathsDataset.read(raw.data(), strType, pathsMemory, pathsSpace);
+        for (hsize_t i = 0; i < count; ++i) {
+            paths[i] = raw[i] ? raw[i] : "";
+        }
+        H5::DataSet::vlenReclaim(raw.data(), strType, pathsMemory);
+    } else {
+        size_t length = strType.getSize();
+        std::vector<char> raw(count * length);
+        pathsDataset.read(raw.data(), strType, pathsMemory, pathsSpace);
+        for (hsize_t i = 0; i < count; ++i) {
+            const char* begin = raw.data() + i * length;
+            paths[i].assign(begin, std::find(begin, begin + length, '\0'));
+        }
+    }
+
+    return batch;
+}
+
+// Lee el archivo por bloques de batchSize filas; la memoria la acota la cola que recibe los lotes
+void readEmbeddingsFromHDF5(const H5std_string& FILE_NAME, size_t batchSize, const BatchCallback& onBatch) {
     try{
         H5::H5File file(FILE_NAME, H5F_ACC_RDONLY);
-
-        // Leer dataset "features"
         H5::DataSet featuresDataset = file.openDataSet("features");
-        H5::DataSpace featuresSpace = featuresDataset.getSpace();
-        const int num_embeddings = featuresSpace.getSimpleExtentNpoints();
-        double* embeddingData = new double[num_embeddings];
-        featuresDataset.read(embeddingData, H5::PredType::NATIVE_DOUBLE);
-        // Leer dataset "paths"
         H5::DataSet pathsDataset = file.openDataSet("paths");
-        H5::StrType strType = pathsDataset.getStrType();
-        H5::DataSpace pathsSpace = pathsDataset.getSpace();
-        const int num_paths = pathsSpace.getSimpleExtentNpoints();
-        std::vector<H5std_string> paths(num_paths);
-        pathsDataset.read(paths.data(), strType);
-        for (int i = 0; i < num_paths; ++i) {
-            Point embedding(num_embeddings);
-            for (int j = 0; j < num_embeddings; ++j) {
-                embedding[j] = embeddingData[i * num_embeddings + j];
-            }
-            data.push_back({embedding, paths[i]});
+
+        H5::DataSpace featuresSpace = featuresDataset.getSpace();
+        if (featuresSpace.getSimpleExtentNdims() != 2) {
+            throw std::runtime_error("El dataset 'features' debe ser una matriz N x D");
+        }
+        hsize_t dims[2];
+        featuresSpace.getSimpleExtentDims(dims);
+        hsize_t rows = std::min<hsize_t>(dims[0], pathsDataset.getSpace().getSimpleExtentNpoints());
+        hsize_t dim = dims[1];
+        hsize_t chunk = std::max<hsize_t>(batchSize, 1);
+
+        for (hsize_t start = 0; start < rows; start += chunk) {
+            onBatch(readHDF5Chunk(featuresDataset, pathsDataset, start, std::min(chunk, rows - start), dim));
         }
-        delete[] embeddingData;
         file.close();
     } catch(H5::Exception& error) {
-        std::cerr << error.getCDetailMsg() << std::endl;
+        throw std::runtime_error(error.getCDetailMsg());
+    }
+}
+
+// Lee un archivo .fvecs/.bvecs/.npy mapeado en memoria. Las rutas se toman de <archivo>.paths
+// (una por línea) si existe; si no, cada punto se identifica por su número de fila.
+void readEmbeddingsFromVectorFile(const std::string& FILE_NAME, size_t batchSize, const BatchCallback& onBatch) {
+    VectorFile vectors(FILE_NAME);
+    std::ifstream pathsFile(FILE_NAME + ".paths");
+    size_t chunk = std::max<size_t>(batchSize, 1);
+
+    for (size_t start = 0; start < vectors.size(); start += chunk) {
+        size_t count = std::min(chunk, vectors.size() - start);
+        RawBatch batch;
+        batch.dim = vectors.dim();
+        batch.coordinates.resize(count * vectors.dim());
+        batch.paths.resize(count);
+        for (size_t i = 0; i < count; ++i) {
+            vectors.read(start + i, batch.coordinates.data() + i * vectors.dim());
+            if (!pathsFile.is_open() || !std::getline(pathsFile, batch.paths[i])) {
+                batch.paths[i] = std::to_string(start + i);
+            }
+        }
+        onBatch(std::move(batch));
+    }
+}
+
+bool hasExtension(const std::string& fileName, const std::string& extension) {
+    return fileName.size() >= extension.size() &&
+           fileName.compare(fileName.size() - extension.size(), extension.size(), extension) == 0;
+}
+
+// Etapa de conversión: del lote crudo a los puntos que guarda el árbol
+std::vector<ImageData> toImageData(RawBatch&& raw) {
+    size_t count = raw.paths.size();
+    std::vector<ImageData> batch;
+    batch.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        const float* coordinates = raw.coordinates.data() + i * raw.dim;
+        Point embedding(std::vector<NType>(coordinates, coordinates + raw.dim));
+        batch.push_back({std::move(embedding), std::move(raw.paths[i])});
+    }
+    return batch;
+}
+
+enum class InputFormat { Auto, Json, Hdf5, Vectors };
+enum class BuildStrategy { Insert, Bulk };
+
+struct IndexingOptions {
+    std::string input = "../embedding.json";
+    std::string output = "../embbeding.dat";
+    InputFormat format = InputFormat::Auto;
+    BuildStrategy strategy = BuildStrategy::Insert;
+    SsTreeParams params;
+    size_t batchSize = 1024;
+    size_t threads = std::max(1u, std::thread::hardware_concurrency() / 2);
+    bool append = false;            // agregar como segmentos delta en lugar de reconstruir
+    bool compact = false;           // con append, mezclar los segmentos en el índice antes de salir
+    size_t segmentCapacity = 4096;
+    size_t shards = 1;              // más de uno construye un ShardedSsTree
+    ShardingPolicy sharding = ShardingPolicy::Hash;
+    size_t ivfLists = 0;            // más de cero construye un IvfSsTree con esa cantidad de clusters
+    size_t nprobe = 8;
+    bool inspect = false;           // solo reportar la estructura del índice existente
+};
+
+// Pico de memoria residente del proceso en MiB (ru_maxrss está en KiB en Linux)
+double peakRssMiB() {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss / 1024.0;
+}
+
+void readEmbeddings(const IndexingOptions& options, const BatchCallback& onBatch) {
+    InputFormat format = options.format;
+    if (format == InputFormat::Auto) {
+        if (hasExtension(options.input, ".h5") || hasExtension(options.input, ".hdf5")) {
+            format = InputFormat::Hdf5;
+        } else if (hasExtension(options.input, ".fvecs") || hasExtension(options.input, ".bvecs") ||
+                   hasExtension(options.input, ".npy")) {
+            format = InputFormat::Vectors;
+        } else {
+            format = InputFormat::Json;
+        }
+    }
+    switch (format) {
+        case InputFormat::Hdf5:    readEmbeddingsFromHDF5(options.input, options.batchSize, onBatch); break;
+        case InputFormat::Vectors: readEmbeddingsFromVectorFile(options.input, options.batchSize, onBatch); break;
+        default:                   readEmbeddingsFromJson(options.input, options.batchSize, onBatch); break;
     }
+}
+
+void printReport(const SsTree& tree, size_t points, double seconds, double waitSeconds, double buildSeconds) {
+    std::cout << std::fixed << std::setprecision(2);
+    std::cout << "puntos: " << points << " en " << seconds << " s (" << points / std::max(seconds, 1e-9) << " pts/s)" << std::endl;
+    // Si la inserción pasa la mayor parte del tiempo esperando lotes, el cuello de botella es la lectura
+    std::cout << "espera de lectura: " << waitSeconds << " s, construcción: " << buildSeconds << " s" << std::endl;
+    std::cout << "pico de memoria residente: " << peakRssMiB() << " MiB" << std::endl;
 
-    return data;
+    std::cout << tree.stats() << std::flush;
 }
 
-int main() {
-    const std::string FILE_NAME = "../embedding.json";
-    std::vector<ImageData> data = readEmbeddingsFromJson(FILE_NAME);
+// Estructura y validez de un índice ya construido, sin reconstruirlo: llenado y solapamiento indican si
+// conviene reconstruirlo
+void inspectIndex(const IndexingOptions& options) {
     SsTree tree;
-    for (ImageData& item : data) {
-        item.embedding;
-        tree.insert(item.embedding, item.path);
-    }
-    cout<<tree.nivel0()<<endl;
-    cout<<tree.nivel1()<<endl;
-    tree.test();
-    std::string filename = "../embbeding.dat";
-    tree.saveToFile(filename);
+    tree.loadFromFile(options.output);
+    std::cout << options.output << std::endl;
+    std::cout << tree.stats() << std::flush;
+    if (!tree.test()) {
+        throw std::runtime_error("El índice " + options.output + " no cumple los invariantes del SS-tree");
+    }
+}
+
+// Indexación en etapas conectadas por colas acotadas:
+//   lectura/parseo (1 hilo) -> conversión a Point (options.threads hilos) -> consume (hilo llamador).
+// Las colas limitan la memoria a unos pocos lotes en vuelo en lugar del conjunto completo.
+// Devuelve el número de puntos consumidos; waitSeconds acumula el tiempo que consume esperó lotes.
+size_t runPipeline(const IndexingOptions& options, const std::function<void(std::vector<ImageData>&&)>& consume,
+                   double& waitSeconds) {
+    using Clock = std::chrono::steady_clock;
+    const size_t QUEUE_CAPACITY = 4;
+    BoundedQueue<RawBatch> rawQueue(QUEUE_CAPACITY);
+    BoundedQueue<std::vector<ImageData>> pointQueue(QUEUE_CAPACITY);
+    size_t converterThreads = std::max<size_t>(options.threads, 1);
+
+    // Un error de lectura no puede salir del hilo: se guarda y se relanza al terminar, para que quien
+    // llama no guarde un índice construido con una entrada incompleta
+    std::exception_ptr readError;
+    std::thread reader([&]() {
+        BatchCallback push = [&rawQueue](RawBatch&& batch) {
+            if (!rawQueue.push(std::move(batch))) {
+                throw std::runtime_error("Indexación cancelada");
+            }
+        };
+        try {
+            readEmbeddings(options, push);
+        } catch (...) {
+            readError = std::current_exception();
+        }
+        rawQueue.close();
+    });
+
+    std::vector<std::thread> converters;
+    std::atomic<size_t> activeConverters(converterThreads);
+    for (size_t i = 0; i < converterThreads; ++i) {
+        converters.emplace_back([&]() {
+            while (std::optional<RawBatch> raw = rawQueue.pop()) {
+                if (!pointQueue.push(toImageData(std::move(*raw)))) {
+                    break;
+                }
+            }
+            // El último conversor en terminar cierra la cola de la etapa siguiente
+            if (--activeConverters == 0) {
+                pointQueue.close();
+            }
+        });
+    }
+
+    size_t consumed = 0;
+    Clock::time_point start = Clock::now();
+    Clock::time_point lastReport = start;
+    Clock::duration waiting{0};
+    try {
+        while (true) {
+            Clock::time_point waitStart = Clock::now();
+            std::optional<std::vector<ImageData>> batch = pointQueue.pop();
+            waiting += Clock::now() - waitStart;
+            if (!batch) {
+                break;
+            }
+            size_t count = batch->size();
+            consume(std::move(*batch));
+            consumed += count;
+
+            Clock::time_point now = Clock::now();
+            if (now - lastReport >= std::chrono::seconds(1)) {
+                double seconds = std::chrono::duration<double>(now - start).count();
+                std::cerr << consumed << " puntos, " << std::fixed << std::setprecision(0) << consumed / seconds
+                          << " pts/s, " << std::setprecision(1) << peakRssMiB() << " MiB" << std::endl;
+                lastReport = now;
+            }
+        }
+    } catch (...) {
+        rawQueue.close();
+        pointQueue.close();
+        reader.join();
+        for (std::thread& converter : converters) {
+            converter.join();
+        }
+        throw;
+    }
+    reader.join();
+    for (std::thread& converter : converters) {
+        converter.join();
+    }
+    if (readError) {
+        std::rethrow_exception(readError);
+    }
+    waitSeconds = std::chrono::duration<double>(waiting).count();
+    return consumed;
+}
+
+// Construye el índice completo; con BuildStrategy::Bulk acumula los puntos y los empaqueta al final.
+// El guardado necesita el árbol terminado, así que empieza cuando acaba la construcción.
+void buildIndex(const IndexingOptions& options) {
+    using Clock = std::chrono::steady_clock;
+    SsTree tree(options.params);
+    std::vector<Point> pending;
+    Clock::time_point start = Clock::now();
+    double waitSeconds = 0;
+    size_t inserted = runPipeline(options, [&](std::vector<ImageData>&& batch) {
+        for (ImageData& item : batch) {
+            if (options.strategy == BuildStrategy::Bulk) {
+                item.embedding.path = "../" + item.path;
+                pending.push_back(std::move(item.embedding));
+            } else {
+                tree.insert(std::move(item.embedding), item.path);
+            }
+        }
+    }, waitSeconds);
+    if (options.strategy == BuildStrategy::Bulk) {
+        tree.bulkLoad(std::move(pending));
+    }
+    if (inserted == 0) {
+        throw std::runtime_error("No se indexó ningún punto");
+    }
+
+    double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    printReport(tree, inserted, seconds, waitSeconds, seconds - waitSeconds);
+    if (!tree.test()) {
+        throw std::runtime_error("El índice construido no pasó la validación; no se guarda " + options.output);
+    }
+    tree.saveToFile(options.output);
+}
+
+// Lee toda la entrada en memoria, para los índices que reparten los puntos antes de construir
+std::vector<Point> collectPoints(const IndexingOptions& options, double& waitSeconds) {
+    std::vector<Point> points;
+    runPipeline(options, [&](std::vector<ImageData>&& batch) {
+        for (ImageData& item : batch) {
+            item.embedding.path = "../" + item.path;
+            points.push_back(std::move(item.embedding));
+        }
+    }, waitSeconds);
+    if (points.empty()) {
+        throw std::runtime_error("No se indexó ningún punto");
+    }
+    return points;
+}
+
+void printThroughput(size_t points, double seconds, double waitSeconds) {
+    std::cout << std::fixed << std::setprecision(2);
+    std::cout << "puntos: " << points << " en " << seconds << " s (" << points / std::max(seconds, 1e-9) << " pts/s)" << std::endl;
+    std::cout << "espera de lectura: " << waitSeconds << " s, construcción: " << seconds - waitSeconds << " s" << std::endl;
+    std::cout << "pico de memoria residente: " << peakRssMiB() << " MiB" << std::endl;
+}
+
+// Construye un índice repartido en options.shards árboles; cada shard se construye en su propio hilo
+void buildShardedIndex(const IndexingOptions& options) {
+    using Clock = std::chrono::steady_clock;
+    Clock::time_point start = Clock::now();
+    double waitSeconds = 0;
+    std::vector<Point> points = collectPoints(options, waitSeconds);
+    size_t count = points.size();
+
+    ShardedSsTree index(options.shards, options.sharding, options.params);
+    index.build(std::move(points));
+    printThroughput(count, std::chrono::duration<double>(Clock::now() - start).count(), waitSeconds);
+    for (size_t s = 0; s < index.shardCount(); ++s) {
+        std::vector<LevelStats> levels = index.shard(s).levelStats();
+        std::cout << "  shard " << s << ": " << (levels.empty() ? 0 : levels.back().entries) << " puntos, altura "
+                  << levels.size() << std::endl;
+    }
+    index.saveToFile(options.output);
+}
+
+// Construye un índice IVF de options.ivfLists clusters; el cuantizador se entrena con la propia entrada
+void buildIvfIndex(const IndexingOptions& options) {
+    using Clock = std::chrono::steady_clock;
+    Clock::time_point start = Clock::now();
+    double waitSeconds = 0;
+    std::vector<Point> points = collectPoints(options, waitSeconds);
+    size_t count = points.size();
+
+    IvfSsTree index(options.ivfLists, options.params, options.nprobe);
+    index.build(std::move(points));
+    printThroughput(count, std::chrono::duration<double>(Clock::now() - start).count(), waitSeconds);
+
+    size_t smallest = count;
+    size_t largest = 0;
+    for (size_t list = 0; list < index.listCount(); ++list) {
+        smallest = std::min(smallest, index.listSize(list));
+        largest = std::max(largest, index.listSize(list));
+    }
+    std::cout << "listas: " << index.listCount() << " (entre " << smallest << " y " << largest << " puntos), nprobe "
+              << index.getNprobe() << std::endl;
+    index.saveToFile(options.output);
+}
+
+// Agrega los embeddings a un índice existente como segmentos delta, sin reconstruirlo. La entrada se
+// lee completa antes de tocar el índice: cada insert queda en el log, y una lectura que falla a la
+// mitad no debe dejar filas sueltas en el .delta.
+void appendToIndex(const IndexingOptions& options) {
+    using Clock = std::chrono::steady_clock;
+    Clock::time_point start = Clock::now();
+    double waitSeconds = 0;
+    std::vector<ImageData> items;
+    size_t appended = runPipeline(options, [&](std::vector<ImageData>&& batch) {
+        std::move(batch.begin(), batch.end(), std::back_inserter(items));
+    }, waitSeconds);
+
+    SegmentedSsTree index(options.output, options.segmentCapacity, options.params);
+    for (ImageData& item : items) {
+        index.insert(std::move(item.embedding), item.path);
+    }
+    if (options.compact) {
+        index.compact();
+    } else {
+        index.waitForCompaction();
+    }
+
+    double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    std::cout << std::fixed << std::setprecision(2);
+    std::cout << "puntos agregados: " << appended << " en " << seconds << " s (" << appended / std::max(seconds, 1e-9)
+              << " pts/s)" << std::endl;
+    std::cout << "espera de lectura: " << waitSeconds << " s" << std::endl;
+    std::cout << "puntos en el índice: " << index.size() << ", pendientes de compactar: " << index.pendingSize() << std::endl;
+    std::cout << "pico de memoria residente: " << peakRssMiB() << " MiB" << std::endl;
+}
+
+void printUsage(const char* program) {
+    std::cout << "uso: " << program << " [opciones] [entrada]\n"
+              << "  -i, --input ARCHIVO     embeddings a indexar (por defecto ../embedding.json)\n"
+              << "  -f, --format FORMATO    auto, json, hdf5 o vectors (.fvecs/.bvecs/.npy); auto usa la extensión\n"
+              << "  -o, --output ARCHIVO    índice de salida (por defecto ../embbeding.dat)\n"
+              << "      --fanout N          entradas máximas por nodo; reemplaza el ajuste por --node-bytes\n"
+              << "      --node-bytes N      bytes por nodo para ajustar las capacidades a la dimensión (16384)\n"
+              << "      --strategy S        insert (inserción uno a uno) o bulk (empaquetado al final)\n"
+              << "      --split S           maxvariance, minoverlap o kmeans\n"
+              << "      --reinsert          reinserción forzada al desbordar hojas\n"
+              << "  -a, --append            agrega la entrada al índice existente como segmentos delta (<salida>.delta)\n"
+              << "      --compact           con --append, mezcla los segmentos en el índice antes de salir\n"
+              << "      --segment N         puntos por segmento delta (4096)\n"
+              << "      --shards N          reparte el índice en N árboles (<salida> y <salida>.<i>)\n"
+              << "      --sharding P        hash (por ruta) o cluster (k-means) para --shards\n"
+              << "      --ivf N             índice IVF: N clusters k-means, un árbol por cluster\n"
+              << "      --nprobe N          clusters que recorre cada consulta del índice IVF (8)\n"
+              << "      --inspect           reporta altura, llenado, solapamiento, memoria y validez de <salida> (un solo árbol)\n"
+              << "  -t, --threads N         hilos de conversión\n"
+              << "  -b, --batch N           puntos por lote\n"
+              << "  -h, --help              muestra esta ayuda" << std::endl;
+}
+
+// Devuelve false si hay que terminar (ayuda o argumento inválido)
+bool parseArguments(int argc, char** argv, IndexingOptions& options) {
+    options.params.nodeBytes = 16384;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        auto value = [&]() -> std::string {
+            if (i + 1 >= argc) {
+                throw std::invalid_argument("Falta el valor de " + arg);
+            }
+            return argv[++i];
+        };
+
+        if (arg == "-h" || arg == "--help") {
+            printUsage(argv[0]);
+            return false;
+        } else if (arg == "-i" || arg == "--input") {
+            options.input = value();
+        } else if (arg == "-o" || arg == "--output") {
+            options.output = value();
+        } else if (arg == "-f" || arg == "--format") {
+            std::string format = value();
+            if (format == "auto") options.format = InputFormat::Auto;
+            else if (format == "json") options.format = InputFormat::Json;
+            else if (format == "hdf5") options.format = InputFormat::Hdf5;
+            else if (format == "vectors") options.format = InputFormat::Vectors;
+            else throw std::invalid_argument("Formato desconocido: " + format);
+        } else if (arg == "--fanout") {
+            size_t fanout = std::stoul(value());
+            if (fanout < 4) {
+                throw std::invalid_argument("--fanout debe ser al menos 4");
+            }
+            options.params.leafMax = options.params.innerMax = fanout;
+            options.params.leafMin = options.params.innerMin = std::max<size_t>(2, fanout * 2 / 5);
+            options.params.nodeBytes = 0;
+        } else if (arg == "--node-bytes") {
+            options.params.nodeBytes = std::stoul(value());
+        } else if (arg == "--strategy") {
+            std::string strategy = value();
+            if (strategy == "insert") options.strategy = BuildStrategy::Insert;
+            else if (strategy == "bulk") options.strategy = BuildStrategy::Bulk;
+            else throw std::invalid_argument("Estrategia desconocida: " + strategy);
+        } else if (arg == "--split") {
+            std::string split = value();
+            if (split == "maxvariance") options.params.split = SplitPolicy::MaxVariance;
+            else if (split == "minoverlap") options.params.split = SplitPolicy::MinOverlap;
+            else if (split == "kmeans") options.params.split = SplitPolicy::KMeans;
+            else throw std::invalid_argument("Política de división desconocida: " + split);
+        } else if (arg == "--reinsert") {
+            options.params.reinsert = true;
+        } else if (arg == "-a" || arg == "--append") {
+            options.append = true;
+        } else if (arg == "--compact") {
+            options.compact = true;
+        } else if (arg == "--segment") {
+            options.segmentCapacity = std::stoul(value());
+        } else if (arg == "--shards") {
+            options.shards = std::max<size_t>(std::stoul(value()), 1);
+        } else if (arg == "--sharding") {
+            std::string sharding = value();
+            if (sharding == "hash") options.sharding = ShardingPolicy::Hash;
+            else if (sharding == "cluster") options.sharding = ShardingPolicy::Cluster;
+            else throw std::invalid_argument("Reparto desconocido: " + sharding);
+        } else if (arg == "--ivf") {
+            options.ivfLists = std::stoul(value());
+        } else if (arg == "--nprobe") {
+            options.nprobe = std::stoul(value());
+        } else if (arg == "--inspect") {
+            options.inspect = true;
+        } else if (arg == "-t" || arg == "--threads") {
+            options.threads = std::stoul(value());
+        } else if (arg == "-b" || arg == "--batch") {
+            options.batchSize = std::stoul(value());
+        } else if (!arg.empty() && arg[0] != '-') {
+            options.input = arg;
+        } else {
+            throw std::invalid_argument("Opción desconocida: " + arg);
+        }
+    }
+    return true;
+}
+
+int main(int argc, char** argv) {
+    IndexingOptions options;
+    try {
+        if (!parseArguments(argc, argv, options)) {
+            return 0;
+        }
+    } catch (std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    try {
+        if (options.inspect) {
+            inspectIndex(options);
+        } else if (options.append) {
+            appendToIndex(options);
+        } else if (options.ivfLists > 0) {
+            buildIvfIndex(options);
+        } else if (options.shards > 1) {
+            buildShardedIndex(options);
+        } else {
+            buildIndex(options);
+        }
+    } catch (std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
 }
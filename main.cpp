@@ -4,9 +4,8 @@
 #include "SStree.h"
 
 int main() {
-    // Create a random number generator
-    std::random_device rd;
-    std::mt19937 gen(rd());
+    // Semilla fija: el mismo árbol en cada corrida (datos con estructura: ss_tree_dataset)
+    std::mt19937 gen(42);
     std::uniform_real_distribution<> dis(-10.0, 10.0);
 
     std::vector<Point> points(500, Point(50));
@@ -22,8 +21,7 @@ int main() {
         tree.insert(point);
     }
     //tree.print();
-    cout << tree.nivel0() << endl;
-    cout << tree.nivel1() << endl;
+    cout << tree.stats();
     tree.test();
     //std::string filename = "sstree.dat";
     //tree.saveToFile(filename);
@@ -3,7 +3,9 @@
 
 #include <cmath>
 #include <stdexcept>
+#include <string>
 #include <type_traits>
+#include <algorithm>
 
 template <typename T>
 class Safe {
@@ -183,11 +185,67 @@ Safe<T> max(const Safe<T>& a, const Safe<T>& b) {
 
 using NType = Safe<float>;
 
-namespace Settings {
-    inline size_t M = 8;
-    inline size_t m = 4;
-    inline size_t D = 0;
-}
+// Heurísticas disponibles para dividir un nodo desbordado
+enum class SplitPolicy {
+    MaxVariance,    // corte en la dirección de máxima varianza (SS-tree original)
+    MinOverlap,     // distribución que minimiza el solapamiento entre esferas (estilo R*)
+    KMeans          // 2-means sobre los centroides de las entradas
+};
+
+// La política por defecto se elige al compilar (-DSSTREE_SPLIT_POLICY=KMeans)
+#ifndef SSTREE_SPLIT_POLICY
+#define SSTREE_SPLIT_POLICY MaxVariance
+#endif
+
+// Parámetros de capacidad y construcción de un árbol
+struct SsTreeParams {
+    size_t leafMax = 8;     // M de las hojas
+    size_t leafMin = 4;     // m de las hojas
+    size_t innerMax = 8;    // M de los nodos internos
+    size_t innerMin = 4;    // m de los nodos internos
+    SplitPolicy split = SplitPolicy::SSTREE_SPLIT_POLICY;
+
+    // Reinserción forzada (estilo R*): en el primer desborde de una hoja durante una inserción
+    // se reinsertan desde la raíz las entradas más alejadas del centroide antes de dividir
+    bool reinsert = false;
+    float reinsertFraction = 0.3f;
+
+    // Si es distinto de 0, las capacidades se derivan de la dimensión en la primera inserción
+    size_t nodeBytes = 0;
+
+    // Una división reparte M + 1 entradas en dos nodos de al menos m: hace falta 2 <= m <= M / 2
+    void validate() const {
+        auto check = [](size_t minEntries, size_t maxEntries, const char* node) {
+            if (minEntries < 2 || minEntries > maxEntries / 2) {
+                throw std::invalid_argument(std::string("Capacidades inválidas para ") + node + ": m=" +
+                                            std::to_string(minEntries) + ", M=" + std::to_string(maxEntries) +
+                                            " (se requiere 2 <= m <= M/2)");
+            }
+        };
+        check(leafMin, leafMax, "las hojas");
+        check(innerMin, innerMax, "los nodos internos");
+    }
+
+    // Capacidades para que las entradas de un nodo ocupen aproximadamente nodeBytes
+    static SsTreeParams forDimension(size_t D, size_t nodeBytes = 16384) {
+        const size_t MIN_CAPACITY = 4;
+        const size_t MAX_CAPACITY = 512;
+        auto clampCapacity = [&](size_t capacity) {
+            return std::max(MIN_CAPACITY, std::min(MAX_CAPACITY, capacity));
+        };
+
+        // Hoja: coordenadas de cada punto; interno: centroide, radio y puntero a cada hijo
+        size_t leafEntry = std::max<size_t>(D, 1) * sizeof(float);
+        size_t innerEntry = leafEntry + sizeof(float) + sizeof(void*);
+
+        SsTreeParams params;
+        params.leafMax = clampCapacity(nodeBytes / leafEntry);
+        params.innerMax = clampCapacity(nodeBytes / innerEntry);
+        params.leafMin = std::max<size_t>(2, params.leafMax * 2 / 5);
+        params.innerMin = std::max<size_t>(2, params.innerMax * 2 / 5);
+        return params;
+    }
+};
 
 
 #endif // PARAMS_H
\ No newline at end of file
@@ -0,0 +1,366 @@
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <string>
+#include <random>
+#include <chrono>
+#include <thread>
+#include <queue>
+#include <unordered_map>
+#include <unordered_set>
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include "LoadedIndex.h"
+#include "VectorFile.h"
+
+// Mide la calidad de las consultas kNN contra la verdad exacta calculada por fuerza bruta:
+// recall@k, razón de distancias, nodos visitados y percentiles de latencia. Con un índice IVF
+// recorre varios nprobe para mostrar el compromiso entre velocidad y exactitud.
+
+struct RecallOptions {
+    std::string index = "../embbeding.dat";
+    IndexType type = IndexType::Tree;
+    std::string queryFile;          // vacío: consultas tomadas del propio índice con ruido
+    size_t queryCount = 1000;
+    size_t k = 10;
+    std::vector<size_t> nprobes = {1, 2, 4, 8, 16, 32};
+    size_t threads = std::max(1u, std::thread::hardware_concurrency());
+    uint32_t seed = 42;
+    bool csv = false;
+};
+
+// Todos los puntos del índice en una matriz contigua (n x D), con la fila de cada ruta para evaluar
+// los resultados con las coordenadas guardadas y no con lo que el índice informa de sí mismo
+struct Dataset {
+    size_t n = 0;
+    size_t D = 0;
+    std::vector<NType> coordinates;
+    std::unordered_map<std::string, size_t> rows;
+};
+
+Dataset collect(const LoadedIndex& index) {
+    Dataset data;
+    index.forEachPoint([&](const Point& point) {
+        if (data.D == 0) {
+            data.D = point.dim();
+        }
+        data.coordinates.insert(data.coordinates.end(), point.data(), point.data() + point.dim());
+        data.rows.emplace(point.path, data.n);
+        ++data.n;
+    });
+    if (data.n == 0) {
+        throw std::runtime_error("El índice está vacío");
+    }
+    return data;
+}
+
+std::vector<Point> loadQueries(const RecallOptions& options, const Dataset& data) {
+    std::vector<Point> queries;
+    if (!options.queryFile.empty()) {
+        VectorFile file(options.queryFile);
+        if (file.dim() != data.D) {
+            throw std::runtime_error("Las consultas tienen dimensión " + std::to_string(file.dim()) + " y el índice " +
+                                     std::to_string(data.D));
+        }
+        size_t count = std::min(options.queryCount, file.size());
+        for (size_t i = 0; i < count; ++i) {
+            queries.push_back(file.point(i));
+        }
+        return queries;
+    }
+
+    // Puntos del índice desplazados con ruido de un 10% de la desviación típica de las coordenadas:
+    // parecidos a los datos pero sin coincidir exactamente con ninguno
+    double sum = 0;
+    double sumSquares = 0;
+    for (const NType& value : data.coordinates) {
+        sum += value.getValue();
+        sumSquares += value.getValue() * value.getValue();
+    }
+    double count = static_cast<double>(data.coordinates.size());
+    double stddev = std::sqrt(std::max(0.0, sumSquares / count - (sum / count) * (sum / count)));
+
+    std::mt19937 gen(options.seed);
+    std::uniform_int_distribution<size_t> pick(0, data.n - 1);
+    std::normal_distribution<float> noise(0.0f, static_cast<float>(0.1 * stddev));
+    for (size_t i = 0; i < options.queryCount; ++i) {
+        const NType* row = data.coordinates.data() + pick(gen) * data.D;
+        Point query(data.D);
+        for (size_t j = 0; j < data.D; ++j) {
+            query[j] = row[j].getValue() + noise(gen);
+        }
+        queries.push_back(std::move(query));
+    }
+    return queries;
+}
+
+// Raíces de las k menores distancias al cuadrado de distance(i), i en [0, n), de menor a mayor
+template <typename Distance>
+std::vector<float> smallestDistances(size_t n, size_t k, Distance distance) {
+    std::priority_queue<float> best;    // el tope es el peor de los k mejores
+    for (size_t i = 0; i < n; ++i) {
+        float d = distance(i);
+        if (best.size() < k) {
+            best.push(d);
+        } else if (d < best.top()) {
+            best.pop();
+            best.push(d);
+        }
+    }
+    std::vector<float> distances(best.size());
+    for (size_t r = best.size(); r-- > 0;) {
+        distances[r] = std::sqrt(best.top());
+        best.pop();
+    }
+    return distances;
+}
+
+// Con la dimensión en FixedDims la consulta se copia a un FixedPoint<N> y cada fila usa el núcleo de
+// dimensión fija, sin volver a elegir núcleo en cada distancia
+template <size_t N>
+std::vector<float> exactNeighborsFixed(const Dataset& data, const Point& query, size_t k) {
+    FixedPoint<N> fixed(query);
+    return smallestDistances(data.n, k, [&](size_t i) {
+        return squaredDistanceFixed<N>(fixed.data(), data.coordinates.data() + i * N);
+    });
+}
+
+template <size_t... Ns>
+bool exactNeighborsDispatch(std::index_sequence<Ns...>, const Dataset& data, const Point& query, size_t k,
+                            std::vector<float>& result) {
+    return ((data.D == Ns && (result = exactNeighborsFixed<Ns>(data, query, k), true)) || ...);
+}
+
+std::vector<float> exactNeighbors(const Dataset& data, const Point& query, size_t k) {
+    std::vector<float> result;
+    if (!exactNeighborsDispatch(FixedDims{}, data, query, k, result)) {
+        result = smallestDistances(data.n, k, [&](size_t i) {
+            return squaredDistanceRuntime(query.data(), data.coordinates.data() + i * data.D, data.D);
+        });
+    }
+    return result;
+}
+
+// Distancias exactas a los k vecinos de cada consulta (ordenadas de menor a mayor), repartiendo las
+// consultas entre hilos
+std::vector<std::vector<float>> bruteForce(const Dataset& data, const std::vector<Point>& queries, size_t k,
+                                           size_t threads) {
+    std::vector<std::vector<float>> truth(queries.size());
+    auto work = [&](size_t first, size_t last) {
+        for (size_t q = first; q < last; ++q) {
+            truth[q] = exactNeighbors(data, queries[q], k);
+        }
+    };
+
+    std::vector<std::thread> workers;
+    size_t chunk = (queries.size() + threads - 1) / threads;
+    for (size_t first = 0; first < queries.size(); first += chunk) {
+        workers.emplace_back(work, first, std::min(queries.size(), first + chunk));
+    }
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+    return truth;
+}
+
+struct Evaluation {
+    double recall = 0;
+    double distanceRatio = 0;
+    double innerPerQuery = 0;
+    double leavesPerQuery = 0;
+    double distancesPerQuery = 0;
+    std::vector<double> latenciesMs;    // ordenadas
+
+    double percentile(double p) const {
+        size_t rank = static_cast<size_t>(std::ceil(p * latenciesMs.size()));
+        return latenciesMs[std::min(latenciesMs.size() - 1, rank == 0 ? 0 : rank - 1)];
+    }
+};
+
+// Las consultas corren de a una para que la latencia no incluya competencia entre hilos.
+// El recall se cuenta por distancia (resultados dentro de la k-ésima distancia exacta) para que los
+// empates no penalicen una respuesta igual de buena. La distancia se recalcula desde la consulta hasta
+// el punto devuelto y cada ruta cuenta una sola vez: un resultado repetido o con la distancia mal
+// informada no suma.
+Evaluation evaluate(const LoadedIndex& index, const Dataset& data, const std::vector<Point>& queries,
+                    const std::vector<std::vector<float>>& truth, size_t k, size_t nprobe) {
+    Evaluation result;
+    size_t found = 0;
+    size_t expected = 0;
+    double ratioSum = 0;
+    size_t ratioCount = 0;
+    QueryStats stats;
+    for (size_t q = 0; q < queries.size(); ++q) {
+        auto start = std::chrono::steady_clock::now();
+        std::vector<Neighbor> neighbors = index.search(queries[q], k, nprobe, &stats);
+        auto end = std::chrono::steady_clock::now();
+        result.latenciesMs.push_back(std::chrono::duration<double, std::milli>(end - start).count());
+
+        const std::vector<float>& exact = truth[q];
+        float kth = exact.back();
+        float tolerance = kth * 1e-5f + 1e-6f;
+        std::vector<float> distances;
+        std::unordered_set<size_t> seen;
+        for (const Neighbor& neighbor : neighbors) {
+            auto row = data.rows.find(neighbor.path);
+            if (row == data.rows.end() || !seen.insert(row->second).second) {
+                continue;
+            }
+            const NType* point = data.coordinates.data() + row->second * data.D;
+            distances.push_back(std::sqrt(squaredDistance(queries[q].data(), point, data.D)));
+        }
+        std::sort(distances.begin(), distances.end());
+
+        size_t hits = 0;
+        for (size_t r = 0; r < distances.size(); ++r) {
+            if (distances[r] <= kth + tolerance) {
+                ++hits;
+            }
+            if (r < exact.size() && exact[r] > 0) {
+                ratioSum += distances[r] / exact[r];
+                ++ratioCount;
+            }
+        }
+        found += std::min(hits, exact.size());
+        expected += exact.size();
+    }
+    std::sort(result.latenciesMs.begin(), result.latenciesMs.end());
+    result.recall = expected > 0 ? static_cast<double>(found) / expected : 1.0;
+    result.distanceRatio = ratioCount > 0 ? ratioSum / ratioCount : 1.0;
+    result.innerPerQuery = static_cast<double>(stats.innerVisited) / queries.size();
+    result.leavesPerQuery = static_cast<double>(stats.leavesVisited) / queries.size();
+    result.distancesPerQuery = static_cast<double>(stats.distanceComputations) / queries.size();
+    return result;
+}
+
+void printRow(const std::string& config, const Evaluation& e, size_t k, bool csv) {
+    if (csv) {
+        std::cout << config << "," << k << "," << e.recall << "," << e.distanceRatio << "," << e.innerPerQuery << ","
+                  << e.leavesPerQuery << "," << e.distancesPerQuery << "," << e.percentile(0.5) << "," << e.percentile(0.9) << ","
+                  << e.percentile(0.99) << "," << e.latenciesMs.back() << std::endl;
+        return;
+    }
+    std::cout << std::left << std::setw(12) << config << std::right << std::fixed << std::setprecision(4)
+              << std::setw(10) << e.recall << std::setw(12) << e.distanceRatio << std::setprecision(1)
+              << std::setw(12) << e.innerPerQuery << std::setw(10) << e.leavesPerQuery << std::setw(14)
+              << e.distancesPerQuery << std::setprecision(3)
+              << std::setw(10) << e.percentile(0.5) << std::setw(10) << e.percentile(0.9) << std::setw(10)
+              << e.percentile(0.99) << std::setw(10) << e.latenciesMs.back() << std::endl;
+}
+
+void printUsage(const char* program) {
+    std::cout << "uso: " << program << " [opciones]\n"
+              << "  -i, --index ARCHIVO     índice a evaluar (por defecto ../embbeding.dat)\n"
+              << "      --type T            tree, sharded o ivf (tipo con el que se construyó el índice)\n"
+              << "  -q, --queries ARCHIVO   consultas .fvecs/.bvecs/.npy; sin él se toman puntos del índice con ruido\n"
+              << "  -n, --count N           cantidad de consultas (1000)\n"
+              << "  -k N                    vecinos por consulta (10)\n"
+              << "      --nprobe A,B,...    valores de nprobe a recorrer con --type ivf (1,2,4,8,16,32)\n"
+              << "  -t, --threads N         hilos de la fuerza bruta\n"
+              << "      --seed N            semilla de las consultas generadas (42)\n"
+              << "      --csv               salida CSV en lugar de tabla\n"
+              << "  -h, --help              muestra esta ayuda" << std::endl;
+}
+
+bool parseArguments(int argc, char** argv, RecallOptions& options) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        auto value = [&]() -> std::string {
+            if (i + 1 >= argc) {
+                throw std::invalid_argument("Falta el valor de " + arg);
+            }
+            return argv[++i];
+        };
+
+        if (arg == "-h" || arg == "--help") {
+            printUsage(argv[0]);
+            return false;
+        } else if (arg == "-i" || arg == "--index") {
+            options.index = value();
+        } else if (arg == "--type") {
+            options.type = parseIndexType(value());
+        } else if (arg == "-q" || arg == "--queries") {
+            options.queryFile = value();
+        } else if (arg == "-n" || arg == "--count") {
+            options.queryCount = std::max<size_t>(std::stoul(value()), 1);
+        } else if (arg == "-k") {
+            options.k = std::max<size_t>(std::stoul(value()), 1);
+        } else if (arg == "--nprobe") {
+            options.nprobes.clear();
+            std::string list = value();
+            size_t start = 0;
+            while (start <= list.size()) {
+                size_t comma = std::min(list.find(',', start), list.size());
+                options.nprobes.push_back(std::max<size_t>(std::stoul(list.substr(start, comma - start)), 1));
+                start = comma + 1;
+            }
+        } else if (arg == "-t" || arg == "--threads") {
+            options.threads = std::max<size_t>(std::stoul(value()), 1);
+        } else if (arg == "--seed") {
+            options.seed = static_cast<uint32_t>(std::stoul(value()));
+        } else if (arg == "--csv") {
+            options.csv = true;
+        } else {
+            throw std::invalid_argument("Opción desconocida: " + arg);
+        }
+    }
+    return true;
+}
+
+void runEvaluation(const RecallOptions& options) {
+    LoadedIndex index;
+    index.load(options.index, options.type);
+
+    Dataset data = collect(index);
+    std::vector<Point> queries = loadQueries(options, data);
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::vector<float>> truth = bruteForce(data, queries, options.k, options.threads);
+    double truthSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    if (options.csv) {
+        std::cout << "config,k,recall,distance_ratio,inner_per_query,leaves_per_query,distances_per_query,"
+                     "p50_ms,p90_ms,p99_ms,max_ms" << std::endl;
+    } else {
+        std::cout << data.n << " puntos, D=" << data.D << ", " << queries.size() << " consultas, k=" << options.k
+                  << std::endl;
+        std::cout << "verdad exacta por fuerza bruta: " << std::fixed << std::setprecision(2) << truthSeconds
+                  << " s con " << options.threads << " hilos" << std::endl;
+        std::cout << std::left << std::setw(12) << "config" << std::right << std::setw(10) << "recall" << std::setw(12)
+                  << "dist ratio" << std::setw(12) << "internos/q" << std::setw(10) << "hojas/q" << std::setw(14)
+                  << "distancias/q" << std::setw(10) << "p50 ms" << std::setw(10) << "p90 ms" << std::setw(10)
+                  << "p99 ms" << std::setw(10) << "max ms" << std::endl;
+    }
+
+    if (options.type == IndexType::Ivf) {
+        for (size_t nprobe : options.nprobes) {
+            printRow("nprobe=" + std::to_string(nprobe), evaluate(index, data, queries, truth, options.k, nprobe), options.k,
+                     options.csv);
+        }
+    } else {
+        printRow(options.type == IndexType::Sharded ? "sharded" : "tree",
+                 evaluate(index, data, queries, truth, options.k, 0), options.k, options.csv);
+    }
+}
+
+int main(int argc, char** argv) {
+    RecallOptions options;
+    try {
+        if (!parseArguments(argc, argv, options)) {
+            return 0;
+        }
+    } catch (std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    try {
+        runEvaluation(options);
+    } catch (std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
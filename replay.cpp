@@ -0,0 +1,290 @@
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <string>
+#include <random>
+#include <chrono>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include "LoadedIndex.h"
+#include "VectorFile.h"
+#include "Metrics.h"
+
+// Reproduce un registro de consultas contra un índice a una tasa objetivo. Con --qps las consultas
+// llegan según un calendario fijo (lazo abierto): si el índice no da abasto, la espera se acumula y se
+// ve en la latencia de respuesta, en lugar de que el generador baje la tasa sin avisar. Sin --qps cada
+// hilo lanza la siguiente consulta apenas termina la anterior (lazo cerrado, mide el máximo sostenible).
+//
+// El registro es un archivo de vectores: el que graba la interfaz con SSTREE_QUERY_LOG o las consultas
+// de ss_tree_dataset. Se recorre en orden y vuelve a empezar si la duración pedida lo excede.
+
+enum class Arrivals { Fixed, Poisson };
+
+struct ReplayOptions {
+    std::string index = "../embbeding.dat";
+    IndexType type = IndexType::Tree;
+    std::string queries = "../queries.fvecs";
+    double qps = 0;                 // 0: lazo cerrado
+    double duration = 0;            // segundos; 0: una pasada por el registro
+    Arrivals arrivals = Arrivals::Fixed;
+    size_t k = 10;
+    size_t nprobe = 0;              // 0: el del índice
+    size_t threads = std::max(1u, std::thread::hardware_concurrency());
+    uint32_t seed = 42;
+    bool metrics = false;
+};
+
+// Latencias de una corrida, en milisegundos
+struct ReplayResult {
+    std::vector<double> service;    // desde que la consulta empieza hasta que termina
+    std::vector<double> response;   // desde que debía empezar según el calendario hasta que termina
+    size_t late = 0;                // consultas que empezaron más de 1 ms tarde
+    double seconds = 0;
+    QueryStats stats;
+};
+
+double percentile(const std::vector<double>& sorted, double p) {
+    if (sorted.empty()) {
+        return 0;
+    }
+    size_t rank = static_cast<size_t>(std::ceil(p * sorted.size()));
+    return sorted[std::min(sorted.size() - 1, rank == 0 ? 0 : rank - 1)];
+}
+
+// Momento de llegada de cada consulta, en segundos desde el inicio
+std::vector<double> schedule(const ReplayOptions& options, size_t count) {
+    std::vector<double> offsets(count);
+    std::mt19937 gen(options.seed);
+    std::exponential_distribution<double> gap(options.qps);
+    double time = 0;
+    for (size_t i = 0; i < count; ++i) {
+        offsets[i] = time;
+        time += options.arrivals == Arrivals::Poisson ? gap(gen) : 1.0 / options.qps;
+    }
+    return offsets;
+}
+
+ReplayResult replay(const LoadedIndex& index, const std::vector<Point>& log, const ReplayOptions& options) {
+    using Clock = std::chrono::steady_clock;
+    const bool openLoop = options.qps > 0;
+    size_t total = log.size();
+    if (openLoop && options.duration > 0) {
+        total = static_cast<size_t>(options.qps * options.duration);
+    }
+    std::vector<double> offsets = openLoop ? schedule(options, total) : std::vector<double>();
+
+    ReplayResult result;
+    std::atomic<size_t> next{0};
+    std::mutex resultMutex;
+    Clock::time_point start = Clock::now();
+    Clock::time_point deadline = start + std::chrono::duration_cast<Clock::duration>(
+                                             std::chrono::duration<double>(options.duration));
+
+    auto work = [&]() {
+        std::vector<double> service;
+        std::vector<double> response;
+        size_t late = 0;
+        QueryStats sum;
+        while (true) {
+            size_t i = next++;
+            Clock::time_point due;
+            if (openLoop) {
+                if (i >= total) {
+                    break;
+                }
+                due = start + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(offsets[i]));
+                std::this_thread::sleep_until(due);
+            } else {
+                if (options.duration > 0 ? Clock::now() >= deadline : i >= total) {
+                    break;
+                }
+            }
+
+            Clock::time_point begin = Clock::now();
+            if (!openLoop) {
+                due = begin;
+            }
+            QueryStats stats;
+            index.search(log[i % log.size()], options.k, options.nprobe, &stats);
+            Clock::time_point end = Clock::now();
+
+            service.push_back(std::chrono::duration<double, std::milli>(end - begin).count());
+            response.push_back(std::chrono::duration<double, std::milli>(end - due).count());
+            if (begin - due > std::chrono::milliseconds(1)) {
+                ++late;
+            }
+            sum += stats;
+            MetricsRegistry::global().recordQuery(stats);
+        }
+
+        std::lock_guard<std::mutex> lock(resultMutex);
+        result.service.insert(result.service.end(), service.begin(), service.end());
+        result.response.insert(result.response.end(), response.begin(), response.end());
+        result.late += late;
+        result.stats += sum;
+    };
+
+    std::vector<std::thread> workers;
+    for (size_t t = 1; t < options.threads; ++t) {
+        workers.emplace_back(work);
+    }
+    work();
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+    result.seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    std::sort(result.service.begin(), result.service.end());
+    std::sort(result.response.begin(), result.response.end());
+    return result;
+}
+
+void printLatencies(const std::string& name, const std::vector<double>& sorted) {
+    std::cout << std::left << std::setw(12) << name << std::right << std::fixed << std::setprecision(3)
+              << std::setw(10) << percentile(sorted, 0.5) << std::setw(10) << percentile(sorted, 0.9)
+              << std::setw(10) << percentile(sorted, 0.99) << std::setw(10) << percentile(sorted, 0.999)
+              << std::setw(10) << (sorted.empty() ? 0.0 : sorted.back()) << std::endl;
+}
+
+void runReplay(const ReplayOptions& options) {
+    LoadedIndex index;
+    index.load(options.index, options.type);
+
+    VectorFile file(options.queries);
+    if (file.size() == 0) {
+        throw std::runtime_error("El registro de consultas está vacío: " + options.queries);
+    }
+    size_t indexDim = 0;
+    index.forEachPoint([&](const Point& point) {
+        if (indexDim == 0) {
+            indexDim = point.dim();
+        }
+    });
+    if (indexDim != file.dim()) {
+        throw std::runtime_error("Las consultas tienen dimensión " + std::to_string(file.dim()) + " y el índice " +
+                                 std::to_string(indexDim));
+    }
+    std::vector<Point> log;
+    log.reserve(file.size());
+    for (size_t i = 0; i < file.size(); ++i) {
+        log.push_back(file.point(i));
+    }
+
+    ReplayResult result = replay(index, log, options);
+    size_t count = result.service.size();
+    if (count == 0) {
+        throw std::runtime_error("No se ejecutó ninguna consulta");
+    }
+
+    std::cout << count << " consultas de " << options.queries << " (" << log.size() << " en el registro) con "
+              << options.threads << " hilos, k=" << options.k << std::endl;
+    std::cout << std::fixed << std::setprecision(1) << "tasa: " << count / result.seconds << " consultas/s";
+    if (options.qps > 0) {
+        std::cout << " (objetivo " << options.qps << ", "
+                  << (options.arrivals == Arrivals::Poisson ? "llegadas de Poisson" : "llegadas regulares") << ")";
+    }
+    std::cout << " en " << std::setprecision(2) << result.seconds << " s" << std::endl;
+    if (options.qps > 0) {
+        // Muchas consultas atrasadas indican que la tasa objetivo supera la capacidad del índice
+        std::cout << "atrasadas más de 1 ms: " << result.late << " (" << std::setprecision(1)
+                  << 100.0 * result.late / count << "%)" << std::endl;
+    }
+    std::cout << std::setprecision(1) << "por consulta: " << double(result.stats.innerVisited) / count
+              << " internos, " << double(result.stats.leavesVisited) / count << " hojas, "
+              << double(result.stats.distanceComputations) / count << " distancias" << std::endl;
+
+    std::cout << std::left << std::setw(12) << "latencia ms" << std::right << std::setw(10) << "p50" << std::setw(10)
+              << "p90" << std::setw(10) << "p99" << std::setw(10) << "p99.9" << std::setw(10) << "max" << std::endl;
+    printLatencies("servicio", result.service);
+    if (options.qps > 0) {
+        printLatencies("respuesta", result.response);
+    }
+    if (options.metrics) {
+        MetricsRegistry::global().dump(std::cout);
+    }
+}
+
+void printUsage(const char* program) {
+    std::cout << "uso: " << program << " [opciones]\n"
+              << "  -i, --index ARCHIVO     índice consultado (por defecto ../embbeding.dat)\n"
+              << "      --type T            tree, sharded o ivf (tipo con el que se construyó el índice)\n"
+              << "  -q, --queries ARCHIVO   registro de consultas .fvecs/.bvecs/.npy (por defecto ../queries.fvecs)\n"
+              << "      --qps X             tasa objetivo en consultas/s; sin ella, lazo cerrado\n"
+              << "      --duration S        segundos de carga; sin ella, una pasada por el registro\n"
+              << "      --arrivals A        fixed (intervalos iguales) o poisson, con --qps\n"
+              << "  -k N                    vecinos por consulta (10)\n"
+              << "      --nprobe N          clusters por consulta con --type ivf (el del índice)\n"
+              << "  -t, --threads N         hilos que atienden consultas\n"
+              << "      --seed N            semilla de las llegadas de Poisson (42)\n"
+              << "      --metrics           imprime los histogramas de las consultas (nodos, distancias, fases)\n"
+              << "  -h, --help              muestra esta ayuda" << std::endl;
+}
+
+bool parseArguments(int argc, char** argv, ReplayOptions& options) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        auto value = [&]() -> std::string {
+            if (i + 1 >= argc) {
+                throw std::invalid_argument("Falta el valor de " + arg);
+            }
+            return argv[++i];
+        };
+
+        if (arg == "-h" || arg == "--help") {
+            printUsage(argv[0]);
+            return false;
+        } else if (arg == "-i" || arg == "--index") {
+            options.index = value();
+        } else if (arg == "--type") {
+            options.type = parseIndexType(value());
+        } else if (arg == "-q" || arg == "--queries") {
+            options.queries = value();
+        } else if (arg == "--qps") {
+            options.qps = std::max(std::stod(value()), 0.0);
+        } else if (arg == "--duration") {
+            options.duration = std::max(std::stod(value()), 0.0);
+        } else if (arg == "--arrivals") {
+            std::string arrivals = value();
+            if (arrivals == "fixed") options.arrivals = Arrivals::Fixed;
+            else if (arrivals == "poisson") options.arrivals = Arrivals::Poisson;
+            else throw std::invalid_argument("Llegadas desconocidas: " + arrivals);
+        } else if (arg == "-k") {
+            options.k = std::max<size_t>(std::stoul(value()), 1);
+        } else if (arg == "--nprobe") {
+            options.nprobe = std::stoul(value());
+        } else if (arg == "-t" || arg == "--threads") {
+            options.threads = std::max<size_t>(std::stoul(value()), 1);
+        } else if (arg == "--seed") {
+            options.seed = static_cast<uint32_t>(std::stoul(value()));
+        } else if (arg == "--metrics") {
+            options.metrics = true;
+        } else {
+            throw std::invalid_argument("Opción desconocida: " + arg);
+        }
+    }
+    return true;
+}
+
+int main(int argc, char** argv) {
+    ReplayOptions options;
+    try {
+        if (!parseArguments(argc, argv, options)) {
+            return 0;
+        }
+    } catch (std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    try {
+        runReplay(options);
+    } catch (std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,61 @@
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <random>
+#include <chrono>
+#include "SStree.h"
+#include "ClusterGenerator.h"
+
+// Compara la calidad del árbol resultante con cada política de división:
+// suma de radios por nivel y nodos visitados por consulta kNN, con y sin reinserción forzada.
+
+const size_t NUM_POINTS = 5000;
+const size_t NUM_QUERIES = 200;
+const size_t DIM = 50;
+const size_t K = 10;
+
+const char* policyName(SplitPolicy policy) {
+    switch (policy) {
+        case SplitPolicy::MaxVariance: return "MaxVariance";
+        case SplitPolicy::MinOverlap:  return "MinOverlap";
+        case SplitPolicy::KMeans:      return "KMeans";
+    }
+    return "?";
+}
+
+int main() {
+    std::mt19937 gen(42);
+    std::vector<Point> centers = clusterCenters(DIM, gen);
+    std::vector<Point> points = sampleClusters(centers, NUM_POINTS, gen);
+    std::vector<Point> queries = sampleClusters(centers, NUM_QUERIES, gen);
+
+    for (SplitPolicy policy : {SplitPolicy::MaxVariance, SplitPolicy::MinOverlap, SplitPolicy::KMeans}) {
+        for (bool reinsert : {false, true}) {
+            SsTreeParams params;
+            params.split = policy;
+            params.reinsert = reinsert;
+
+            auto start = std::chrono::steady_clock::now();
+            SsTree tree(params);
+            tree.build(points);
+            auto end = std::chrono::steady_clock::now();
+            double buildMs = std::chrono::duration<double, std::milli>(end - start).count();
+
+            QueryStats stats;
+            for (const Point& query : queries) {
+                tree.kNNQuery(query, K, &stats);
+            }
+
+            std::cout << policyName(policy) << (reinsert ? " + reinsercion" : "") << std::endl;
+            std::cout << "  construccion: " << std::fixed << std::setprecision(1) << buildMs << " ms" << std::endl;
+            std::vector<NType> sums = tree.radiusSumPerLevel();
+            for (size_t level = 0; level < sums.size(); ++level) {
+                std::cout << "  nivel " << level << ": suma de radios " << sums[level] << std::endl;
+            }
+            std::cout << "  nodos internos por consulta: " << double(stats.innerVisited) / NUM_QUERIES << std::endl;
+            std::cout << "  hojas por consulta: " << double(stats.leavesVisited) / NUM_QUERIES << std::endl;
+        }
+    }
+
+    return 0;
+}
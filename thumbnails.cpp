@@ -0,0 +1,146 @@
+#include <SFML/Graphics.hpp>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <deque>
+#include <fstream>
+#include <future>
+#include <thread>
+#include <chrono>
+#include <algorithm>
+#include <stdexcept>
+
+#include "SegmentedSsTree.h"
+#include "ThumbnailStore.h"
+#include "ThreadPool.h"
+
+// Genera el almacén de miniaturas que usa la interfaz para mostrar resultados sin decodificar las
+// imágenes originales: una miniatura por cada ruta del índice (incluidos los segmentos delta).
+
+struct ThumbnailOptions {
+    std::string index = "../embbeding.dat";
+    std::string output = "../thumbnails.dat";
+    size_t side = 200;      // el tamaño con el que la interfaz dibuja cada resultado
+    size_t threads = std::max(1u, std::thread::hardware_concurrency());
+};
+
+void printUsage(const char* program) {
+    std::cout << "uso: " << program << " [opciones]\n"
+              << "  -i, --index ARCHIVO     índice cuyas rutas se procesan (por defecto ../embbeding.dat)\n"
+              << "  -o, --output ARCHIVO    almacén de miniaturas (por defecto ../thumbnails.dat)\n"
+              << "  -s, --size N            lado de cada miniatura en pixeles (200)\n"
+              << "  -t, --threads N         hilos de decodificación\n"
+              << "  -h, --help              muestra esta ayuda" << std::endl;
+}
+
+bool parseArguments(int argc, char** argv, ThumbnailOptions& options) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        auto value = [&]() -> std::string {
+            if (i + 1 >= argc) {
+                throw std::invalid_argument("Falta el valor de " + arg);
+            }
+            return argv[++i];
+        };
+
+        if (arg == "-h" || arg == "--help") {
+            printUsage(argv[0]);
+            return false;
+        } else if (arg == "-i" || arg == "--index") {
+            options.index = value();
+        } else if (arg == "-o" || arg == "--output") {
+            options.output = value();
+        } else if (arg == "-s" || arg == "--size") {
+            options.side = std::max<size_t>(std::stoul(value()), 1);
+        } else if (arg == "-t" || arg == "--threads") {
+            options.threads = std::max<size_t>(std::stoul(value()), 1);
+        } else {
+            throw std::invalid_argument("Opción desconocida: " + arg);
+        }
+    }
+    return true;
+}
+
+void buildThumbnails(const ThumbnailOptions& options) {
+    if (!std::ifstream(options.index) && !std::ifstream(options.index + ".delta")) {
+        throw std::runtime_error("No existe el índice " + options.index);
+    }
+    std::vector<std::string> paths;
+    {
+        // Solo lectura: recorrer el índice no debe reescribir su registro ni lanzar una compactación
+        SegmentedSsTree index(options.index, 4096, SsTreeParams(), nullptr, SegmentedSsTree::OpenMode::ReadOnly);
+        index.forEachPoint([&](const Point& point) {
+            paths.push_back(point.path);
+        });
+    }
+    std::sort(paths.begin(), paths.end());
+    paths.erase(std::unique(paths.begin(), paths.end()), paths.end());
+    std::cout << paths.size() << " imágenes en " << options.index << std::endl;
+
+    auto start = std::chrono::steady_clock::now();
+    ThreadPool workers(options.threads);
+    ThumbnailWriter writer(options.output, options.side);
+    size_t side = options.side;
+    auto decode = [side](const std::string& path) {
+        sf::Image image;
+        if (!image.loadFromFile(path)) {
+            return std::vector<unsigned char>();
+        }
+        return ThumbnailStore::downscale(image.getPixelsPtr(), image.getSize().x, image.getSize().y, side);
+    };
+
+    // Se escribe en orden con una ventana acotada de decodificaciones en curso: la memoria no crece con
+    // el tamaño de la colección
+    std::deque<std::future<std::vector<unsigned char>>> inFlight;
+    size_t next = 0;
+    size_t written = 0;
+    size_t failed = 0;
+    for (size_t i = 0; i < paths.size(); ++i) {
+        while (next < paths.size() && inFlight.size() < options.threads * 4) {
+            std::string path = paths[next++];
+            inFlight.push_back(workers.submit([decode, path]() {
+                return decode(path);
+            }));
+        }
+        std::vector<unsigned char> pixels = inFlight.front().get();
+        inFlight.pop_front();
+        if (pixels.empty()) {
+            ++failed;
+            continue;
+        }
+        writer.add(paths[i], pixels);
+        if (++written % 1000 == 0) {
+            std::cout << "\r" << written << "/" << paths.size() << std::flush;
+        }
+    }
+    writer.finish();
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "\r" << written << " miniaturas de " << side << "x" << side << " en " << options.output << " ("
+              << seconds << " s";
+    if (failed > 0) {
+        std::cout << ", " << failed << " imágenes no se pudieron leer";
+    }
+    std::cout << ")" << std::endl;
+}
+
+int main(int argc, char** argv) {
+    ThumbnailOptions options;
+    try {
+        if (!parseArguments(argc, argv, options)) {
+            return 0;
+        }
+    } catch (std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    try {
+        buildThumbnails(options);
+    } catch (std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}